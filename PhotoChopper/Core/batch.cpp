@@ -0,0 +1,231 @@
+#include "batch.h"
+#include "core.h"
+#include "pipeline.h"
+
+#include <thread>
+#include <vector>
+#include <memory>
+
+#include <opencv2/core.hpp>
+
+#include <exiv2/exiv2.hpp>
+
+#include <windows.h>
+
+#include "../utils/log.h"
+#include "../utils/utils.h"
+#include "../utils/trace.h"
+#include "../utils/matPool.h"
+
+namespace // anonymous
+{
+	// time of waiting for scanner is shown in trace
+	bool nextFile(pc::utils::filesystem::DirectoryScanner& files, pc::utils::filesystem::FileEntry& file, pc::utils::TraceRecorder* trace)
+	{
+		pc::utils::TraceScope scope(trace, "waitForFile", "wait");
+		return files.Next(file);
+	}
+} // namespace anonymous
+
+namespace pc
+{
+
+BatchProcessor::BatchProcessor(const utils::Parameters& params)
+	: m_params(params)
+	, m_nextFile(0u)
+	, m_processedCount(0u)
+	, m_abortedByUser(false)
+{
+	m_stats.SetSampling(size_t(max(0, params.statisticsSamples)), params.statisticsSpillFile);
+}
+
+int BatchProcessor::GetWorkersCount() const
+{
+	int count = m_params.workersCount;
+
+	if (count <= 0)
+		count = max(1, int(std::thread::hardware_concurrency()));
+
+	// windows can be shown only from one thread
+	if (m_params.GUI)
+		count = 1;
+
+	return max(1, count);
+}
+
+size_t BatchProcessor::Run(utils::filesystem::DirectoryScanner& files, bool& abortedByUser)
+{
+	m_stats.Reset();
+	utils::MatPool::get().ResetCounters();
+
+	std::unique_ptr<utils::TraceRecorder> trace;
+	if (m_params.traceFile.empty() == false)
+		trace.reset(new utils::TraceRecorder());
+
+	m_stats.SetTrace(trace.get());
+
+	m_nextFile = 0u;
+	m_processedCount = 0u;
+	m_abortedByUser = false;
+
+	int workersCount = GetWorkersCount();
+
+	if (m_params.GUI && (m_params.workersCount != 1 || m_params.pipeline))
+		pc::Log::get().Write("GUI mode is turned on, so only one worker is used", pc::LogLevel::Warning);
+
+	bool usePipeline = m_params.pipeline && m_params.GUI == false;
+
+	if (workersCount == 1 && usePipeline == false)
+	{
+		// process in calling thread, GUI windows must live there
+		Processor processor(m_params, &m_stats);
+		workerRoutine(processor, files, false);
+	}
+	else
+	{
+		// NOTE each worker is busy by itself, so internal opencv threads only oversubscribe cpu
+		int openCVThreads = cv::getNumThreads();
+		cv::setNumThreads(1);
+
+		// XMP parser must be initialized before exiv2 is used from several threads
+		Exiv2::XmpParser::initialize();
+
+		if (usePipeline)
+		{
+			PipelineProcessor pipeline(m_params, m_stats);
+			m_processedCount = pipeline.Run(files);
+		}
+		else
+		{
+			runWorkers(files, workersCount);
+		}
+
+		Exiv2::XmpParser::terminate();
+		cv::setNumThreads(openCVThreads);
+	}
+
+	m_stats.StopTiming();
+	m_stats.SetTrace(nullptr);
+	m_stats.SetAllocationCounters(utils::MatPool::get().GetCounters());
+
+	if (trace != nullptr)
+	{
+		if (trace->Write(m_params.traceFile))
+			MSG_WRITE("trace is written to " + m_params.traceFile);
+		else
+			pc::Log::get().Write("cant write trace to " + m_params.traceFile, pc::LogLevel::Warning);
+	}
+
+	// files which aren't found yet aren't needed
+	if (m_abortedByUser)
+		files.Stop();
+
+	abortedByUser = m_abortedByUser;
+	return m_processedCount;
+}
+
+void BatchProcessor::runWorkers(utils::filesystem::DirectoryScanner& files, int workersCount)
+{
+	MSG_WRITE("use " + std::to_string(workersCount) + " workers");
+
+	std::vector<std::unique_ptr<Processor>> processors;
+	std::vector<std::thread> workers;
+
+	// all workers write to the same statistics
+	for (int i = 0; i < workersCount; ++i)
+		processors.emplace_back(new Processor(m_params, &m_stats));
+
+	for (int i = 0; i < workersCount; ++i)
+	{
+		Processor* processor = processors[i].get();
+		workers.emplace_back([this, processor, &files]() {
+			workerRoutine(*processor, files, true);
+		});
+	}
+
+	for (auto& worker : workers)
+		worker.join();
+}
+
+void BatchProcessor::workerRoutine(Processor& processor, utils::filesystem::DirectoryScanner& files, bool bufferLog)
+{
+	std::string logBuffer;
+	utils::filesystem::FileEntry file;
+
+	while (m_abortedByUser == false && nextFile(files, file, m_stats.GetTrace()))
+	{
+		size_t index = m_nextFile++;
+		std::string path = file.GetPath();
+
+		if (bufferLog)
+		{
+			logBuffer.clear();
+			pc::Log::SetThreadBuffer(&logBuffer);
+		}
+
+		// NOTE total count grows while directories are scanned
+		MSG_WRITE(" :: " + std::to_string(index + 1u) + "/" + std::to_string(files.GetFoundCount()) + " file: " + path + " :: ");
+
+		bool needToContinue = true;
+		try
+		{
+			utils::TraceScope scope(m_stats.GetTrace(), "processFile", "file", &path);
+			needToContinue = processFile(file, processor);
+		}
+		catch (const std::exception& ex)
+		{
+			pc::Log::get().Write(std::string("unexpected error in worker: ") + ex.what(), pc::LogLevel::Error);
+		}
+
+		++m_processedCount;
+
+		if (bufferLog)
+		{
+			pc::Log::SetThreadBuffer(nullptr);
+			pc::Log::get().Flush(logBuffer);
+		}
+
+		if (needToContinue == false)
+			m_abortedByUser = true;
+	}
+}
+
+bool BatchProcessor::processFile(const utils::filesystem::FileEntry& file, Processor &processor)
+{
+	try
+	{
+		processor.Open(file.GetPath());
+		processor.Process();
+
+		if (m_params.saveFiles)
+		{
+			processor.SaveAs(utils::filesystem::getOutputPath(file.GetPath(), m_params.inputDirectory, m_params.outputDirectory));
+		}
+
+		processor.Close();
+	}
+	catch (const std::exception&)
+	{
+		processor.Close();
+	}
+
+	bool abortedByUser = false;
+
+	if (m_params.GUI)
+	{
+		try
+		{
+			processor.ShowOrigin();
+			processor.ShowResult();
+
+			if (pc::utils::WaitForKeyOpenCV() == pc::utils::KeyEscape)
+				abortedByUser = true;
+		}
+		catch (std::exception&)
+		{ }
+	}
+
+	return !abortedByUser;
+}
+
+}
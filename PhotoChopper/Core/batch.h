@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+#include "../utils/parameters.h"
+#include "../utils/statistics.h"
+#include "../utils/filesystem.h"
+#include "../utils/directoryScanner.h"
+#include "../utils/classutils.h"
+
+namespace pc
+{
+
+class Processor;
+
+// runs processing of found files by several workers, each worker owns its own Processor;
+// or by staged pipeline (see PipelineProcessor) when it's turned on in settings.
+// Files are processed while scanner is still looking for others
+class BatchProcessor : public utils::noncopyable
+{
+public:
+	BatchProcessor(const utils::Parameters& params);
+
+	// returns count of processed files
+	size_t Run(utils::filesystem::DirectoryScanner& files, bool& abortedByUser);
+
+	// statistics of all workers
+	utils::Statistics& GetStatistics() { return m_stats; }
+
+	int GetWorkersCount() const;
+
+private:
+	void runWorkers(utils::filesystem::DirectoryScanner& files, int workersCount);
+	void workerRoutine(Processor& processor, utils::filesystem::DirectoryScanner& files, bool bufferLog);
+	bool processFile(const utils::filesystem::FileEntry& file, Processor& processor);
+
+private:
+	utils::Parameters m_params;
+	utils::Statistics m_stats;
+
+	std::atomic<size_t> m_nextFile;
+	std::atomic<size_t> m_processedCount;
+	std::atomic<bool>	m_abortedByUser;
+};
+
+}
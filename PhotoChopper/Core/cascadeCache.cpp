@@ -0,0 +1,299 @@
+#include "cascadeCache.h"
+
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include "../utils/log.h"
+#include "../utils/utils.h"
+#include "../utils/filesystem.h"
+
+namespace // anonymous
+{
+	const char	   g_compiledMagic[4] = { 'P', 'C', 'C', 'C' };
+	const uint32_t g_compiledVersion = 2u;
+
+	struct CompiledCascadeHeader
+	{
+		char	 magic[4];
+		uint32_t version;
+		uint64_t sourceSize;	// size and last write time of xml file,
+		uint64_t sourceTime;	// compiled file is outdated if they have been changed
+		uint64_t payloadSize;
+	};
+
+	static_assert(sizeof(CompiledCascadeHeader) == 32, "compiled cascade header must not have padding");
+
+	std::string compactNumber(const std::string& token)
+	{
+		if (token.find_first_of(".eE") == std::string::npos)
+			return token;
+
+		char* end = nullptr;
+		double value = std::strtod(token.c_str(), &end);
+		if (end == token.c_str() || *end != '\0')
+			return token;
+
+		// all cascade values are read as float, so float of source text is printed:
+		// 9 digits are enough to restore it exactly (printed double could be rounded to another float)
+		char buf[32];
+		sprintf_s(buf, "%.9g", double(float(value)));
+
+		std::string result(buf);
+
+		// keep value real
+		if (result.find_first_of(".en") == std::string::npos)
+			result += '.';
+
+		return result;
+	}
+
+	void appendCompactText(const std::string& text, std::string& dst)
+	{
+		std::istringstream stream(text);
+		std::string token;
+
+		bool first = true;
+		while (stream >> token)
+		{
+			if (first == false)
+				dst += ' ';
+
+			dst += compactNumber(token);
+			first = false;
+		}
+	}
+
+	std::string minifyCascadeXml(const std::string& src)
+	{
+		std::string dst;
+		dst.reserve(src.size() / 2);
+
+		size_t i = 0u;
+		const size_t n = src.size();
+
+		while (i < n)
+		{
+			if (src.compare(i, 4, "<!--") == 0)
+			{
+				size_t end = src.find("-->", i + 4);
+				i = (end == std::string::npos) ? n : end + 3;
+			}
+			else if (src[i] == '<')
+			{
+				size_t end = src.find('>', i);
+				end = (end == std::string::npos) ? n : end + 1;
+
+				dst.append(src, i, end - i);
+				i = end;
+			}
+			else
+			{
+				// text between tags
+				size_t end = src.find('<', i);
+				if (end == std::string::npos)
+					end = n;
+
+				appendCompactText(src.substr(i, end - i), dst);
+				i = end;
+			}
+		}
+
+		return dst;
+	}
+} // namespace anonymous
+
+namespace pc
+{
+
+std::string GetCompiledCascadePath(const std::string& path)
+{
+	std::string withoutExtension;
+	std::string extension = utils::filesystem::getExtension(path, &withoutExtension);
+
+	return (extension.empty() ? path : withoutExtension) + ".pcc";
+}
+
+bool CompileCascade(const std::string& path, const std::string& compiledPath)
+{
+	CompiledCascadeHeader header;
+	std::memcpy(header.magic, g_compiledMagic, sizeof(header.magic));
+	header.version = g_compiledVersion;
+
+	unsigned long long size = 0u;
+	unsigned long long time = 0u;
+	if (utils::filesystem::getFileSizeAndTime(path, size, time) == false)
+		return false;
+
+	header.sourceSize = size;
+	header.sourceTime = time;
+
+	std::ifstream source(path, std::ios::binary);
+	if (!source)
+		return false;
+
+	std::string xml((std::istreambuf_iterator<char>(source)), std::istreambuf_iterator<char>());
+	std::string payload = minifyCascadeXml(xml);
+
+	// check that result is still readable by opencv
+	try
+	{
+		cv::FileStorage storage(payload, cv::FileStorage::READ | cv::FileStorage::MEMORY);
+		cv::CascadeClassifier classifier;
+
+		if (storage.isOpened() == false || classifier.read(storage.getFirstTopLevelNode()) == false)
+			return false;
+	}
+	catch (const cv::Exception&)
+	{
+		return false;
+	}
+
+	header.payloadSize = payload.size();
+
+	std::ofstream dest(compiledPath, std::ios::binary | std::ios::trunc);
+	if (!dest)
+		return false;
+
+	dest.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	dest.write(payload.data(), payload.size());
+
+	return bool(dest);
+}
+
+CascadeModel::CascadeModel(const std::string& path)
+	: m_path(path)
+	, m_loadTime(0.0)
+	, m_isCompiled(false)
+{
+	utils::Timer timer;
+
+	m_isCompiled = loadCompiled(GetCompiledCascadePath(m_path));
+
+	if (m_isCompiled == false)
+	{
+		try
+		{
+			m_storage.open(m_path, cv::FileStorage::READ);
+		}
+		catch (const cv::Exception&)
+		{
+			m_storage.release();
+		}
+	}
+
+	m_loadTime = timer.ElapsedMs();
+
+	if (m_storage.isOpened())
+		LOG_WRITE("cascade " + m_path + (m_isCompiled ? " (compiled)" : "") + " is loaded in "
+			+ std::to_string(m_loadTime) + " ms", pc::LogLevel::Info);
+	else
+		pc::Log::get().Write("cant load cascade " + m_path, pc::LogLevel::Error);
+}
+
+bool CascadeModel::loadCompiled(const std::string& compiledPath)
+{
+	std::ifstream file(compiledPath, std::ios::in | std::ios::binary | std::ios::ate);
+	if (!file)
+		return false;
+
+	unsigned long long fileSize = (unsigned long long)file.tellg();
+	if (fileSize < sizeof(CompiledCascadeHeader))
+		return false;
+
+	CompiledCascadeHeader header;
+	file.seekg(0, std::ios::beg);
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+	if (!file || std::memcmp(header.magic, g_compiledMagic, sizeof(header.magic)) != 0
+		|| header.version != g_compiledVersion
+		|| header.payloadSize != fileSize - sizeof(header))
+	{
+		pc::Log::get().Write("compiled cascade " + compiledPath + " is broken, use " + m_path, pc::LogLevel::Warning);
+		return false;
+	}
+
+	// xml can be absent, then compiled file is used as is
+	unsigned long long size = 0u;
+	unsigned long long time = 0u;
+	if (utils::filesystem::getFileSizeAndTime(m_path, size, time) && (size != header.sourceSize || time != header.sourceTime))
+	{
+		pc::Log::get().Write("compiled cascade " + compiledPath + " is outdated, use " + m_path, pc::LogLevel::Warning);
+		return false;
+	}
+
+	// NOTE FileStorage parses only files or strings, so payload is read once to string (mapping of file saves nothing)
+	std::string payload(size_t(header.payloadSize), '\0');
+	if (payload.empty() == false && !file.read(&payload[0], std::streamsize(payload.size())))
+		return false;
+
+	try
+	{
+		m_storage.open(payload, cv::FileStorage::READ | cv::FileStorage::MEMORY);
+	}
+	catch (const cv::Exception&)
+	{
+		m_storage.release();
+	}
+
+	return m_storage.isOpened();
+}
+
+cv::Ptr<cv::CascadeClassifier> CascadeModel::CreateClassifier() const
+{
+	cv::Ptr<cv::CascadeClassifier> classifier = cv::makePtr<cv::CascadeClassifier>();
+
+	if (m_storage.isOpened() == false)
+		return classifier;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (classifier->read(m_storage.getFirstTopLevelNode()) == false)
+	{
+		// old format cascades can't be read from node, so load them as usual
+		classifier->load(m_path);
+	}
+
+	return classifier;
+}
+
+CascadeCache& CascadeCache::get()
+{
+	static CascadeCache cache;
+	return cache;
+}
+
+std::shared_ptr<const CascadeModel> CascadeCache::Acquire(const std::string& path)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	TModels::iterator it = m_models.find(path);
+	if (it != m_models.end())
+		return it->second;
+
+	std::shared_ptr<const CascadeModel> model = std::make_shared<CascadeModel>(path);
+	m_models[path] = model;
+
+	return model;
+}
+
+size_t CascadeCache::GetLoadsCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_models.size();
+}
+
+double CascadeCache::GetTotalLoadTime()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	double time = 0.0;
+	for (const auto& model : m_models)
+		time += model.second->GetLoadTime();
+
+	return time;
+}
+
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <opencv2/core.hpp>
+#include <opencv2/objdetect.hpp>
+
+#include "../utils/classutils.h"
+
+namespace pc
+{
+
+// parsed cascade file; immutable after loading, so it's shared by all processors
+class CascadeModel : public utils::noncopyable
+{
+public:
+	CascadeModel(const std::string& path);
+
+	// new classifier with its own detection state, built from already parsed data
+	cv::Ptr<cv::CascadeClassifier> CreateClassifier() const;
+
+	bool IsLoaded() const { return m_storage.isOpened(); }
+	bool IsCompiled() const { return m_isCompiled; }
+	const std::string& GetPath() const { return m_path; }
+
+	// time of parsing cascade file in ms
+	double GetLoadTime() const { return m_loadTime; }
+
+private:
+	bool loadCompiled(const std::string& compiledPath);
+
+private:
+	std::string		m_path;
+	cv::FileStorage m_storage;
+	double			m_loadTime;
+	bool			m_isCompiled;
+
+	mutable std::mutex m_mutex;
+};
+
+// compiled cascade (*.pcc) is a small binary header followed by minified cascade xml:
+// without comments and indents, numbers are printed with float precision.
+// It's used instead of xml if it was compiled from the same xml file.
+// NOTE only xml is minified (smaller file, faster tokenizing), payload is still parsed as xml on load
+std::string GetCompiledCascadePath(const std::string& path);
+bool CompileCascade(const std::string& path, const std::string& compiledPath);
+
+// cascade models cache, every file is parsed only once per process
+class CascadeCache : public utils::noncopyable
+{
+public:
+	// NOTE first call must be done from main thread before any worker is started
+	static CascadeCache& get();
+
+	std::shared_ptr<const CascadeModel> Acquire(const std::string& path);
+
+	// for statistics
+	size_t GetLoadsCount();
+	double GetTotalLoadTime();
+
+private:
+	typedef std::map<std::string, std::shared_ptr<const CascadeModel>> TModels;
+
+	TModels	   m_models;
+	std::mutex m_mutex;
+};
+
+}
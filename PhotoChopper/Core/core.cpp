@@ -4,8 +4,8 @@
 namespace pc
 {
 
-Processor::Processor(const utils::Parameters& params /* = Parameters() */)
-	: m_impl(new ProcessorImpl(params))
+Processor::Processor(const utils::Parameters& params /* = Parameters() */, utils::Statistics* statistics /* = nullptr */)
+	: m_impl(new ProcessorImpl(params, statistics))
 {}
 
 Processor::~Processor()
@@ -31,6 +31,16 @@ void Processor::SaveAs(const std::string& newFilename)
 	m_impl->SaveAs(newFilename);
 }
 
+void Processor::ProcessOriginal()
+{
+	m_impl->ProcessOriginal();
+}
+
+void Processor::Write(const std::string& newFilename)
+{
+	m_impl->Write(newFilename);
+}
+
 utils::Statistics& Processor::GetStatistics()
 {
 	return m_impl->GetStatistics();
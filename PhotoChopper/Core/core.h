@@ -23,7 +23,8 @@ private:
 	std::unique_ptr<ProcessorImpl> m_impl;
 public:
 
-	Processor(const utils::Parameters& params = utils::Parameters());
+	// statistics can be shared by several processors, otherwise processor has its own one
+	Processor(const utils::Parameters& params = utils::Parameters(), utils::Statistics* statistics = nullptr);
 	~Processor();
 
 	void Open(const std::string& filename);
@@ -34,6 +35,10 @@ public:
 	void Save();
 	void SaveAs(const std::string& newFilename);
 
+	// stages of SaveAs: geometry transforms of original image and encoding to file
+	void ProcessOriginal();
+	void Write(const std::string& newFilename);
+
 	void Reset();
 
 	void ShowOrigin();
@@ -1,34 +1,220 @@
 #include "coreImpl.h"
+#include "cascadeCache.h"
 
 #include <opencv2/objdetect.hpp>
 #include <opencv2/imgproc.hpp>
 #include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include "../utils/features.h"
+
+#if PC_FEATURE_DISPLAY
 #include <opencv2/highgui.hpp>
+#endif
 
 #include <exiv2/exiv2.hpp>
 
+#include <turbojpeg.h>
+
+#include <cstring>
+#include <fstream>
+
+#include <windows.h>
+
 #include "../utils/log.h"
 #include "../utils/utils.h"
 #include "../utils/errors.h"
+#include "../utils/exif.h"
 #include "../utils/filesystem.h"
+#include "../utils/trace.h"
+
+namespace // anonymous
+{
+	// NOTE geometry of image is described by 3x3 matrices of pixel coordinates transformation,
+	// pixel centers have integer coordinates (as in opencv)
+
+	cv::Matx33d translateTransform(double x, double y)
+	{
+		return cv::Matx33d(
+			1.0, 0.0, x,
+			0.0, 1.0, y,
+			0.0, 0.0, 1.0);
+	}
+
+	// from image of one size to image of another size, pixels are mapped the same way as in cv::resize
+	cv::Matx33d scaleTransform(const cv::Size& from, const cv::Size& to)
+	{
+		double sx = double(to.width) / double(from.width);
+		double sy = double(to.height) / double(from.height);
+
+		return cv::Matx33d(
+			sx,  0.0, 0.5 * sx - 0.5,
+			0.0, sy,  0.5 * sy - 0.5,
+			0.0, 0.0, 1.0);
+	}
+
+	cv::Matx33d affineToTransform(const cv::Mat& affine)
+	{
+		cv::Matx23d m = affine;
+
+		return cv::Matx33d(
+			m(0, 0), m(0, 1), m(0, 2),
+			m(1, 0), m(1, 1), m(1, 2),
+			0.0,	 0.0,	  1.0);
+	}
+
+	cv::Matx23d transformToAffine(const cv::Matx33d& transform)
+	{
+		return transform.get_minor<2, 3>(0, 0);
+	}
+
+	// the same as cv::flip
+	cv::Matx33d flipTransform(int flipCode, const cv::Size& size)
+	{
+		bool mirrorX = flipCode != 0;
+		bool mirrorY = flipCode <= 0;
+
+		return cv::Matx33d(
+			mirrorX ? -1.0 : 1.0, 0.0, mirrorX ? size.width - 1.0 : 0.0,
+			0.0, mirrorY ? -1.0 : 1.0, mirrorY ? size.height - 1.0 : 0.0,
+			0.0, 0.0, 1.0);
+	}
+
+	// the same as cv::transpose
+	cv::Matx33d transposeTransform(cv::Size& size)
+	{
+		std::swap(size.width, size.height);
+
+		return cv::Matx33d(
+			0.0, 1.0, 0.0,
+			1.0, 0.0, 0.0,
+			0.0, 0.0, 1.0);
+	}
+
+	cv::Matx33d exifOrientationTransform(int orientation, cv::Size& size)
+	{
+		// 1	top	left side
+		// 2	top	right side
+		// 3	bottom	right side
+		// 4	bottom	left side
+		// 5	left side	top
+		// 6	right side	top
+		// 7	right side	bottom
+		// 8	left side	bottom
+
+		//	   1        2       3      4         5            6           7          8
+		//	
+		//	888888  888888      88  88      8888888888  88                  88  8888888888
+		//	88          88      88  88      88  88      88  88          88  88      88  88
+		//	8888      8888    8888  8888    88          8888888888  8888888888          88
+		//	88          88      88  88
+		//	88          88  888888  888888
+
+		enum exifOrient
+		{
+			topleft = 1,
+			topright,
+			bottomright,
+			bottomleft,
+			lefttop,
+			righttop,
+			rightbottom,
+			leftbottom
+		};
+
+		switch (orientation)
+		{
+		case topright:		// 2
+			// mirror vertically
+			return flipTransform(1, size);
+		case bottomright:	// 3
+			// mirror vertically and horizontally
+			return flipTransform(-1, size);
+		case bottomleft:	// 4
+			// mirror horizontally
+			return flipTransform(0, size);
+
+		case righttop:		// 6
+		{
+			// rotate clockwise
+			cv::Matx33d flip = flipTransform(0, size);
+			return transposeTransform(size) * flip;
+		}
+		case leftbottom:	// 8
+		{
+			// rotate counter-clockwise
+			cv::Matx33d flip = flipTransform(1, size);
+			return transposeTransform(size) * flip;
+		}
+
+		case rightbottom:	// 7
+		case lefttop:		// 5
+			// transpose
+			return transposeTransform(size);
+
+		case topleft:		// 1
+		default:
+			return cv::Matx33d::eye();
+		}
+	}
+
+	// lossless jpeg operation which makes the same orientation as transform, -1 if there is no such operation
+	int losslessJpegOperation(const cv::Matx33d& transform)
+	{
+		int xx = cvRound(transform(0, 0)), xy = cvRound(transform(0, 1));
+		int yx = cvRound(transform(1, 0)), yy = cvRound(transform(1, 1));
+
+		if (xy == 0 && yx == 0)
+		{
+			if (xx == 1 && yy == 1)		return TJXOP_NONE;
+			if (xx == -1 && yy == 1)	return TJXOP_HFLIP;
+			if (xx == 1 && yy == -1)	return TJXOP_VFLIP;
+			if (xx == -1 && yy == -1)	return TJXOP_ROT180;
+		}
+		else if (xx == 0 && yy == 0)
+		{
+			if (xy == 1 && yx == 1)		return TJXOP_TRANSPOSE;
+			if (xy == -1 && yx == 1)	return TJXOP_ROT90;
+			if (xy == 1 && yx == -1)	return TJXOP_ROT270;
+			if (xy == -1 && yx == -1)	return TJXOP_TRANSVERSE;
+		}
+
+		return -1;
+	}
+} // namespace anonymous
 
 namespace pc
 {
 
 using stats = utils::Statistics;
 
-ProcessorImpl::ProcessorImpl(const utils::Parameters& params)
+ProcessorImpl::ProcessorImpl(const utils::Parameters& params, utils::Statistics* statistics)
 	: m_params(params)
+	, m_stats(statistics != nullptr ? *statistics : m_ownStats)
+	, m_matPool(utils::MatPool::get())
+	, m_planes(m_matPool)
 	, m_isOpen(false)
 	, m_success(true)
 	, m_needToDelayedCopyResultImageWhenFail(false)
 	, m_exifData(nullptr)
-	, m_cascadeFrontalFace(cv::makePtr<cv::CascadeClassifier>(params.cascadeFrontalFaceTemplate))
-	, m_cascadeEye(cv::makePtr<cv::CascadeClassifier>(params.cascadeEyeTemplate))
-{ }
+	, m_cascadeFrontalFace(CascadeCache::get().Acquire(params.cascadeFrontalFaceTemplate)->CreateClassifier())
+	, m_cascadeEye(CascadeCache::get().Acquire(params.cascadeEyeTemplate)->CreateClassifier())
+	, m_exifOrientation(1)
+	, m_traceStart(0)
+	, m_bytesWritten(0u)
+	, m_jpegDecompressor(tjInitDecompress())
+	, m_jpegTransformer(tjInitTransform())
+{
+	attachMatPool();
+}
 
 ProcessorImpl::~ProcessorImpl()
-{}
+{
+	if (m_jpegDecompressor != nullptr)
+		tjDestroy(m_jpegDecompressor);
+
+	if (m_jpegTransformer != nullptr)
+		tjDestroy(m_jpegTransformer);
+}
 
 void ProcessorImpl::reset()
 {
@@ -43,52 +229,107 @@ void ProcessorImpl::reset()
 
 	m_box.Reset();
 
+	m_fileData.clear();
+	m_exifData.reset();
+	m_losslessData.clear();
+	m_resultSize = cv::Size();
+	m_originSize = cv::Size();
+	m_bytesWritten = 0u;
+	m_exifOrientation = 1;
+
+	m_originImage = cv::Mat();
+	m_preparedSize = cv::Size();
+	m_prepareTransform = cv::Matx33d::eye();
 	m_resizedImage = cv::Mat();
-	m_resizedImageGrayscale = cv::Mat();
-		
-	// NOTE    ,        
-	m_cascadeFrontalFace = cv::makePtr<cv::CascadeClassifier>(m_params.cascadeFrontalFaceTemplate);
-	m_cascadeEye = cv::makePtr<cv::CascadeClassifier>(m_params.cascadeEyeTemplate);
+	m_planes.Reset();
+
+	m_originOverlay.Reset();
+	m_resultOverlay.Reset();
+
+	attachMatPool();
+
+	// NOTE classifiers are created once per processor from shared cascade models (see CascadeCache),
+	// detection results of previous image are kept only in m_faces and m_eyes which are cleared above
+}
+
+void ProcessorImpl::attachMatPool()
+{
+	// NOTE allocator is kept by released mats and copied by assignment, so it's set again only after assignment of new mat
+	m_matPool.Attach(m_originImage);
+	m_matPool.Attach(m_resizedImage);
 }
 
 void ProcessorImpl::Open(const std::string& filename)
 {
 	reset();
 
+	m_imageTimer.Reset();
+
+	if (utils::TraceRecorder* trace = m_stats.GetTrace())
+		m_traceStart = trace->Now();
+
 	try
 	{
 		m_filename = filename;
 
-		m_originImage = cv::imread(m_filename, cv::IMREAD_COLOR);
-		if (m_originImage.empty())
+		readFileData();
+
+		// NOTE for detection only small image is needed, so jpeg is decoded with reduced resolution (by DCT scaling)
+		// and full size image is decoded later only if it's really needed (see ProcessOriginal)
+		cv::Mat image;
+		cv::Size originSize;
+		m_matPool.Attach(image);
+
 		{
-			throw std::exception("opencv cant open image file to read");
+			utils::StageTimer timer(m_stats, stats::Stage::Decode);
+
+			bool reduced = m_params.reducedResolutionDecode && decodeJpeg(image, m_box.xScale, &originSize);
+			if (reduced == false)
+			{
+				decodeOriginImage();
+
+				image = m_originImage;
+				originSize = m_originImage.size();
+			}
 		}
 
 		m_isOpen = true;
+		m_originSize = originSize;
+
+		{
+			utils::StageTimer timer(m_stats, stats::Stage::ReadExif);
+			readAndResetExifOrientation(filename);
+		}
+
+		m_prepareTransform = getPrepareTransform(originSize, m_preparedSize);
 
-  		if (m_params.needToMakeImageBorder)
-  		{
- 			// TODO   -     45  
-  			// TODO      ,    
-  			int borderSize = max(int(m_params.imageBorderMinSize[0]), int(max(m_originImage.cols, m_originImage.rows) * 0.09f));
-    		cv::Mat copy = m_originImage;
-   			cv::copyMakeBorder(copy, m_originImage, borderSize, borderSize, borderSize, borderSize, cv::BORDER_REPLICATE);
-  		}
-
-		applyAndResetExifRotation(filename);
-		applyRotation();
-			
 		// TODO set min size for width and height
-		cv::resize(m_originImage, m_resizedImage, cv::Size(), m_box.xScale, m_box.yScale, CV_INTER_LINEAR);
+		// NOTE size must be the same as size of resized full image, all coordinates are scaled back by m_box scale
+		cv::Size resizedSize(cvRound(m_preparedSize.width * m_box.xScale), cvRound(m_preparedSize.height * m_box.yScale));
+
+		// border, orientation and resize are made by one pass over decoded image,
+		// border replicates pixels of image edges
+		cv::Matx33d transform = scaleTransform(originSize, image.size())
+			* m_prepareTransform.inv()
+			* scaleTransform(resizedSize, m_preparedSize);
+
+		{
+			utils::StageTimer timer(m_stats, stats::Stage::Prepare);
+
+			cv::warpAffine(image, m_resizedImage, transformToAffine(transform), resizedSize,
+				cv::INTER_LINEAR | cv::WARP_INVERSE_MAP, cv::BORDER_REPLICATE);
+		}
+
+		// NOTE resized image isn't changed in place, so overlays and planes refer to it without copy
+		m_planes.Reset(m_resizedImage);
 
-		if (m_params.GUI)
+		if (PC_FEATURE_DISPLAY && m_params.GUI)
 		{
-			m_resizedImage.copyTo(m_displayOrigin);
+			m_originOverlay.Reset(m_resizedImage);
 		}
-		if (m_params.NeedToHaveDisplayedImage())
+		if (PC_FEATURE_DISPLAY && m_params.NeedToHaveDisplayedImage())
 		{
-			m_resizedImage.copyTo(m_displayResult);
+			m_resultOverlay.Reset(m_resizedImage);
 		}
 	
 	}
@@ -105,6 +346,280 @@ void ProcessorImpl::Open(const std::string& filename)
 	}		
 }
 
+void ProcessorImpl::readFileData()
+{
+	utils::StageTimer timer(m_stats, stats::Stage::ReadFile);
+
+	m_fileData.clear();
+
+	std::ifstream file(m_filename, std::ios::binary | std::ios::ate);
+	if (!file)
+		return;
+
+	std::streamoff size = file.tellg();
+	if (size <= 0)
+		return;
+
+	m_fileData.resize(size_t(size));
+
+	file.seekg(0, std::ios::beg);
+	file.read(reinterpret_cast<char*>(&m_fileData[0]), size);
+
+	if (!file)
+		m_fileData.clear();
+
+	m_stats.AddBytesRead(m_fileData.size());
+}
+
+bool ProcessorImpl::decodeJpeg(cv::Mat& image, float minScale, cv::Size* originSize)
+{
+	if (m_fileData.empty() || m_jpegDecompressor == nullptr)
+		return false;
+
+	unsigned char* data = &m_fileData[0];
+	unsigned long size = (unsigned long)m_fileData.size();
+
+	int width = 0;
+	int height = 0;
+	int subsampling = 0;
+	int colorspace = 0;
+
+	// fails for non jpeg files
+	if (tjDecompressHeader3(m_jpegDecompressor, data, size, &width, &height, &subsampling, &colorspace) != 0)
+		return false;
+
+	// choose smallest scale which is not less than required one
+	tjscalingfactor scale = { 1, 1 };
+
+	int factorsCount = 0;
+	const tjscalingfactor* factors = tjGetScalingFactors(&factorsCount);
+
+	for (int i = 0; factors != nullptr && i < factorsCount; ++i)
+	{
+		float factor = float(factors[i].num) / float(factors[i].denom);
+
+		if (factor >= minScale && factor < float(scale.num) / float(scale.denom))
+			scale = factors[i];
+	}
+
+	int scaledWidth = TJSCALED(width, scale);
+	int scaledHeight = TJSCALED(height, scale);
+
+	image.create(scaledHeight, scaledWidth, CV_8UC3);
+
+	if (tjDecompress2(m_jpegDecompressor, data, size, image.data, scaledWidth, int(image.step), scaledHeight, TJPF_BGR, 0) != 0)
+	{
+		image = cv::Mat();
+		return false;
+	}
+
+	if (originSize != nullptr)
+		*originSize = cv::Size(width, height);
+
+	return true;
+}
+
+void ProcessorImpl::decodeOriginImage()
+{
+	if (decodeJpeg(m_originImage, 1.f, nullptr))
+		return;
+
+	if (m_fileData.empty() == false)
+		m_originImage = cv::imdecode(cv::Mat(1, int(m_fileData.size()), CV_8UC1, &m_fileData[0]), cv::IMREAD_COLOR);
+	else
+		m_originImage = cv::imread(m_filename, cv::IMREAD_COLOR);
+
+	if (m_originImage.empty())
+	{
+		throw std::exception("opencv cant open image file to read");
+	}
+}
+
+int ProcessorImpl::getBorderSize(const cv::Size& originSize)
+{
+	if (m_params.needToMakeImageBorder == false)
+		return 0;
+
+	// TODO   -     45  
+	// TODO      ,    
+	return max(int(m_params.imageBorderMinSize[0]), int(max(originSize.width, originSize.height) * 0.09f));
+}
+
+cv::Matx33d ProcessorImpl::getRotationTransform(cv::Size& size)
+{
+	// rotation of image readed from config
+	if (m_params.rotateImage == false)
+		return cv::Matx33d::eye();
+
+	int degree = (m_params.rotateDegree >= 0 ? 1 : -1) * std::abs(m_params.rotateDegree) % 360;
+	switch (degree)
+	{
+	case 90:
+		return exifOrientationTransform(6, size);
+	case -90:
+		return exifOrientationTransform(8, size);
+	case 180:
+	case -180:
+		return exifOrientationTransform(3, size);
+	case 270:
+	{
+		cv::Matx33d flip = exifOrientationTransform(3, size);
+		return exifOrientationTransform(6, size) * flip;
+	}
+	case -270:
+	{
+		cv::Matx33d flip = exifOrientationTransform(3, size);
+		return exifOrientationTransform(8, size) * flip;
+	}
+	default:
+		return cv::Matx33d::eye();
+	}
+}
+
+cv::Matx33d ProcessorImpl::getPrepareTransform(const cv::Size& originSize, cv::Size& preparedSize)
+{
+	int borderSize = getBorderSize(originSize);
+	preparedSize = cv::Size(originSize.width + 2 * borderSize, originSize.height + 2 * borderSize);
+
+	cv::Matx33d transform = translateTransform(borderSize, borderSize);
+	transform = exifOrientationTransform(m_exifOrientation, preparedSize) * transform;
+	transform = getRotationTransform(preparedSize) * transform;
+
+	return transform;
+}
+
+void ProcessorImpl::ensureOriginImage()
+{
+	if (m_originImage.empty() == false)
+		return;
+
+	utils::StageTimer timer(m_stats, stats::Stage::Decode);
+	decodeOriginImage();
+}
+
+bool ProcessorImpl::transformJpegLossless()
+{
+	m_losslessData.clear();
+
+	if (m_params.losslessJpeg == false || IsValid() == false || m_fileData.empty() || m_jpegTransformer == nullptr)
+		return false;
+
+	// small rotation by eyes line is skipped
+	if (m_params.needEyeHorizontalCorrection && std::abs(m_box.angle) > m_params.losslessMaxAngle)
+		return false;
+
+	int operation = losslessJpegOperation(m_prepareTransform);
+	if (operation < 0)
+		return false;
+
+	utils::StageTimer timer(m_stats, stats::Stage::LosslessTransform);
+
+	unsigned char* data = &m_fileData[0];
+	unsigned long size = (unsigned long)m_fileData.size();
+
+	int width = 0;
+	int height = 0;
+	int subsampling = 0;
+	int colorspace = 0;
+
+	// fails for non jpeg files
+	if (tjDecompressHeader3(m_jpegTransformer, data, size, &width, &height, &subsampling, &colorspace) != 0)
+		return false;
+
+	// result region in original image coordinates
+	cv::Rect rect(cv::Point(0, 0), m_preparedSize);
+	if (m_params.needCrop)
+		rect = getCropRect(m_preparedSize);
+
+	cv::Matx33d toOrigin = m_prepareTransform.inv();
+	cv::Vec3d first = toOrigin * cv::Vec3d(rect.x, rect.y, 1.0);
+	cv::Vec3d last = toOrigin * cv::Vec3d(rect.x + rect.width - 1, rect.y + rect.height - 1, 1.0);
+
+	cv::Point originFirst(cvRound(min(first[0], last[0])), cvRound(min(first[1], last[1])));
+	cv::Point originLast(cvRound(max(first[0], last[0])), cvRound(max(first[1], last[1])));
+
+	// NOTE only whole blocks can be moved, so partial blocks on mirrored edges are trimmed
+	// and result mustn't use them (also border can't be made losslessly)
+	int xx = cvRound(m_prepareTransform(0, 0)), xy = cvRound(m_prepareTransform(0, 1));
+	int yx = cvRound(m_prepareTransform(1, 0)), yy = cvRound(m_prepareTransform(1, 1));
+
+	bool mirrorX = xx < 0 || yx < 0;
+	bool mirrorY = xy < 0 || yy < 0;
+	bool transposed = xx == 0;
+
+	cv::Size trimmedSize(width, height);
+	if (mirrorX)
+		trimmedSize.width -= width % tjMCUWidth[subsampling];
+	if (mirrorY)
+		trimmedSize.height -= height % tjMCUHeight[subsampling];
+
+	if (originFirst.x < 0 || originFirst.y < 0 || originLast.x >= trimmedSize.width || originLast.y >= trimmedSize.height)
+		return false;
+
+	// the same orientation as in prepared image, but for trimmed image without border
+	cv::Matx33d transform(
+		xx,  xy,  (xx < 0 ? trimmedSize.width - 1 : 0) + (xy < 0 ? trimmedSize.height - 1 : 0),
+		yx,  yy,  (yx < 0 ? trimmedSize.width - 1 : 0) + (yy < 0 ? trimmedSize.height - 1 : 0),
+		0.0, 0.0, 1.0);
+
+	cv::Vec3d resultFirst = transform * cv::Vec3d(originFirst.x, originFirst.y, 1.0);
+	cv::Vec3d resultLast = transform * cv::Vec3d(originLast.x, originLast.y, 1.0);
+
+	cv::Size resultSize = transposed ? cv::Size(trimmedSize.height, trimmedSize.width) : trimmedSize;
+	cv::Rect result(
+		cvRound(min(resultFirst[0], resultLast[0])),
+		cvRound(min(resultFirst[1], resultLast[1])),
+		cvRound(std::abs(resultLast[0] - resultFirst[0])) + 1,
+		cvRound(std::abs(resultLast[1] - resultFirst[1])) + 1);
+
+	// crop origin must be aligned to blocks of result image, so region is shifted by less than a half of block
+	int blockWidth = transposed ? tjMCUHeight[subsampling] : tjMCUWidth[subsampling];
+	int blockHeight = transposed ? tjMCUWidth[subsampling] : tjMCUHeight[subsampling];
+
+	result.x = cvRound(float(result.x) / float(blockWidth)) * blockWidth;
+	result.y = cvRound(float(result.y) / float(blockHeight)) * blockHeight;
+
+	if (result.x + result.width > resultSize.width)
+		result.x -= blockWidth;
+	if (result.y + result.height > resultSize.height)
+		result.y -= blockHeight;
+
+	if (result.x < 0 || result.y < 0)
+		return false;
+
+	tjtransform jpegTransform;
+	std::memset(&jpegTransform, 0, sizeof(jpegTransform));
+
+	jpegTransform.r.x = result.x;
+	jpegTransform.r.y = result.y;
+	jpegTransform.r.w = result.width;
+	jpegTransform.r.h = result.height;
+	jpegTransform.op = operation;
+	jpegTransform.options = TJXOPT_TRIM | TJXOPT_CROP;
+
+	unsigned char* dstData = nullptr;
+	unsigned long dstSize = 0;
+
+	if (tjTransform(m_jpegTransformer, data, size, 1, &dstData, &dstSize, &jpegTransform, 0) != 0)
+	{
+		std::string msg = std::string("lossless jpeg transformation failed (") + tjGetErrorStr() + "), image will be reencoded";
+		pc::Log::get().Write(msg, pc::LogLevel::Warning);
+
+		if (dstData != nullptr)
+			tjFree(dstData);
+
+		return false;
+	}
+
+	m_losslessData.assign(dstData, dstData + dstSize);
+	m_resultSize = result.size();
+	tjFree(dstData);
+
+	LOG_WRITE("image is transformed losslessly", pc::LogLevel::Info);
+
+	return true;
+}
+
 void ProcessorImpl::Close()
 {
 	if (m_isOpen == false)
@@ -112,6 +627,7 @@ void ProcessorImpl::Close()
 
 	if (m_needToDelayedCopyResultImageWhenFail)
 	{
+		utils::StageTimer timer(m_stats, stats::Stage::CopyFailed);
 		tryToSaveResultImageToDisplayToFile();
 	}
 
@@ -126,12 +642,19 @@ void ProcessorImpl::Close()
 			std::string filenameFull;
 			try
 			{
+				utils::StageTimer timer(m_stats, stats::Stage::CopyFailed);
+
 				filenameFull = utils::filesystem::getFilename(m_filename);
-				utils::filesystem::copyFile(m_filename, m_params.outputDirectory + "/" + filenameFull);
+
+				std::string outputPath = utils::filesystem::getOutputPath(m_filename, m_params.inputDirectory, m_params.outputDirectory);
+
+				std::string error;
+				if (utils::filesystem::copyFile(m_filename, outputPath, false, m_params.copyMode, &error) == false)
+					throw std::exception(error.c_str());
 			}
-			catch (std::exception&)
+			catch (std::exception& ex)
 			{
-				std::string msg = "failed when trying to save original image to result folder when failed (" + filenameFull + ")";
+				std::string msg = "failed when trying to save original image to result folder when failed (" + filenameFull + "): " + ex.what();
 
 				pc::Log::get().Write(msg, pc::LogLevel::Warning);
 				m_stats.AddWarning(stats::Info(m_filename, msg));
@@ -139,6 +662,23 @@ void ProcessorImpl::Close()
 		}
 	}
 
+	m_stats.AddTime(stats::Stage::Image, m_imageTimer.ElapsedMs());
+
+	if (utils::TraceRecorder* trace = m_stats.GetTrace())
+	{
+		utils::TraceFileInfo info;
+		info.filename = m_filename;
+		info.width = m_originSize.width;
+		info.height = m_originSize.height;
+		info.resultWidth = m_resultSize.width;
+		info.resultHeight = m_resultSize.height;
+		info.bytesRead = m_fileData.size();
+		info.bytesWritten = m_bytesWritten;
+		info.success = m_success;
+
+		trace->AddFileEvent(m_traceStart, trace->Now(), info);
+	}
+
 	m_isOpen = false;
 }
 
@@ -153,10 +693,29 @@ void ProcessorImpl::SaveAs(const std::string& newFilename)
 		throw std::exception(msg.c_str());
 	}
 
+	ProcessOriginal();
+	Write(newFilename);
+}
+
+void ProcessorImpl::ProcessOriginal()
+{
+	if (m_isOpen == false)
+	{
+		std::string msg = std::string("trying to process empty file");
+
+		pc::Log::get().Write(msg, pc::LogLevel::Error);
+		m_stats.AddFail(stats::Info(m_filename, msg), stats::FailType::Other);
+		throw std::exception(msg.c_str());
+	}
+
 	// process original image
 	try
 	{
-		this->processOriginalImage();
+		if (this->transformJpegLossless() == false)
+		{
+			this->ensureOriginImage();
+			this->processOriginalImage();
+		}
 	}
 	catch (std::exception&)
 	{
@@ -170,6 +729,18 @@ void ProcessorImpl::SaveAs(const std::string& newFilename)
 
 		throw std::exception(msg.c_str());
 	}
+}
+
+void ProcessorImpl::Write(const std::string& newFilename)
+{
+	if (m_isOpen == false)
+	{
+		std::string msg = std::string("trying to save empty file to ") + newFilename;
+
+		pc::Log::get().Write(msg, pc::LogLevel::Error);
+		m_stats.AddFail(stats::Info(m_filename, msg), stats::FailType::SaveFile);
+		throw std::exception(msg.c_str());
+	}
 
 	if (m_success == false)
 		return;
@@ -177,11 +748,34 @@ void ProcessorImpl::SaveAs(const std::string& newFilename)
 	// save image if success processed
 	try
 	{
-		bool success = cv::imwrite(newFilename, m_originImage);
-		if (!success)
+		// NOTE image is encoded to memory and exif is inserted there, so file is written only once
+		std::vector<unsigned char> encoded;
+
+		if (m_losslessData.empty() == false)
+		{
+			encoded.swap(m_losslessData);
+		}
+		else
+		{
+			utils::StageTimer timer(m_stats, stats::Stage::Encode);
+
+			std::string extension = utils::filesystem::getExtension(newFilename);
+			if (cv::imencode("." + extension, m_originImage, encoded) == false)
+				throw std::exception();
+		}
+
+		insertExif(encoded);
+
+		utils::StageTimer timer(m_stats, stats::Stage::WriteFile);
+
+		std::ofstream file(newFilename, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(&encoded[0]), std::streamsize(encoded.size()));
+
+		if (!file)
 			throw std::exception();
 
-		saveExif(newFilename);
+		m_bytesWritten = encoded.size();
+		m_stats.AddBytesWritten(encoded.size());
 	}
 	catch (std::exception&)
 	{
@@ -204,6 +798,7 @@ bool ProcessorImpl::IsValid()
 
 void ProcessorImpl::ShowOrigin()
 {
+#if PC_FEATURE_DISPLAY
 	if (m_params.GUI == false)
 		return;
 
@@ -219,12 +814,14 @@ void ProcessorImpl::ShowOrigin()
 	}
 
 	// Show our image inside it.
-	cv::imshow("Origin Window", m_displayOrigin); 
+	cv::imshow("Origin Window", m_originOverlay.Render()); 
 	cv::setWindowTitle("Origin Window", m_filename + ", angle: " + (m_params.needEyeHorizontalCorrection ? std::to_string(m_box.angle) : ""));
+#endif
 }
 
 void ProcessorImpl::ShowResult()
 {
+#if PC_FEATURE_DISPLAY
 	if (m_params.GUI == false)
 		return;
 		
@@ -239,7 +836,8 @@ void ProcessorImpl::ShowResult()
 	}
 
 	// Show our image inside it.
-	cv::imshow("Result Window", m_displayResult); 
+	cv::imshow("Result Window", m_resultOverlay.Render()); 
+#endif
 }
 
 void ProcessorImpl::Process(utils::Parameters* params)
@@ -276,21 +874,28 @@ void ProcessorImpl::Process(utils::Parameters* params)
 }
 
 void ProcessorImpl::processImpl()
-{				
-	cv::cvtColor(m_resizedImage, m_resizedImageGrayscale, cv::COLOR_RGB2GRAY);
+{
+	{
+		utils::StageTimer timer(m_stats, stats::Stage::Grayscale);
+		m_planes.Gray();
+	}
 
 	// detect face
-	m_cascadeFrontalFace->detectMultiScale(m_resizedImageGrayscale, m_faces,
-		1.3, 5, 0, cv::Size(80, 80));
+	{
+		utils::StageTimer timer(m_stats, stats::Stage::FaceDetection);
+		m_cascadeFrontalFace->detectMultiScale(m_planes.Gray(), m_faces,
+			1.3, 5, 0, cv::Size(80, 80));
+	}
 		 		
 	int lipsY = findLips();
-	int faceBottomY = findFaceBottom(m_resizedImageGrayscale, lipsY);
+	int faceBottomY = findFaceBottom(m_planes.Gray(), lipsY);
 		
 	bool faceDetectionFailed = m_faces.size() < 1;
 	bool faceDetectionWarning = m_faces.size() > 1;
 
-	bool needToDrawFaceRegions = m_params.drawFacesRegions || ((faceDetectionWarning || faceDetectionFailed) 
-			&& m_params.drawDetectedRegionsWhenException && m_params.NeedToHaveDisplayedImage());
+	// NOTE drawings are compiled out with display feature
+	bool needToDrawFaceRegions = PC_FEATURE_DISPLAY && (m_params.drawFacesRegions || ((faceDetectionWarning || faceDetectionFailed) 
+			&& m_params.drawDetectedRegionsWhenException && m_params.NeedToHaveDisplayedImage()));
 
 	bool needToDrawEyeRegions = false;
 	bool eyesDetectionFailed = true;
@@ -306,8 +911,8 @@ void ProcessorImpl::processImpl()
 		eyesDetectionFailed = m_eyes.size() < 2;
 		eyesDetectionWarning = m_eyes.size() > 2;
 
-		needToDrawEyeRegions = needToDrawFaceRegions || m_params.drawEyesRegions || ((eyesDetectionWarning || eyesDetectionFailed)
-			&& m_params.drawDetectedRegionsWhenException && m_params.NeedToHaveDisplayedImage());
+		needToDrawEyeRegions = PC_FEATURE_DISPLAY && (needToDrawFaceRegions || m_params.drawEyesRegions || ((eyesDetectionWarning || eyesDetectionFailed)
+			&& m_params.drawDetectedRegionsWhenException && m_params.NeedToHaveDisplayedImage()));
 
 		needToDrawFaceRegions = needToDrawFaceRegions || needToDrawEyeRegions;
 			
@@ -325,51 +930,51 @@ void ProcessorImpl::processImpl()
 			{
 				const cv::Rect& rt = m_eyes[j];
 
-				static cv::Scalar color(0, 232, 162);
+				const cv::Scalar color(0, 232, 162);
 				cv::Scalar currentColor = color / double(m_eyes.size() + 1);
-				cv::rectangle(m_displayResult, rt, currentColor * double(m_eyes.size() - (j - 1)), 5);
+				m_resultOverlay.Rectangle(rt, currentColor * double(m_eyes.size() - (j - 1)), 5);
 			}
 		}
 
-		if (m_params.drawLineBetweenEyes && eyesDetectionFailed == false && m_params.NeedToHaveDisplayedImage())
+		if (PC_FEATURE_DISPLAY && m_params.drawLineBetweenEyes && eyesDetectionFailed == false && m_params.NeedToHaveDisplayedImage())
 		{
 			static int thickness = 3;
 
 			assert(eyeCenters.size() >= 2);
 
-			static cv::Scalar lineColor(36, 28, 237);
+			const cv::Scalar lineColor(36, 28, 237);
 
 			// draw line between eyes
-			cv::line(m_displayResult, eyeCenters[0], eyeCenters[1], lineColor, thickness);
+			m_resultOverlay.Line(eyeCenters[0], eyeCenters[1], lineColor, thickness);
 
 			if (m_params.drawExtrapolationLineBetweenEyes)
 			{
-				static cv::Scalar extrapolatedLineColor(163, 73, 164);
+				const cv::Scalar extrapolatedLineColor(163, 73, 164);
 
 				float interpParam = m_params.drawLineBetweenEyesExtrapolationParam;
 
 				cv::Point2f exp1(utils::lerp(eyeCenters[0].x, eyeCenters[1].x, interpParam),
 					utils::lerp(eyeCenters[0].y, eyeCenters[1].y, interpParam));
 
-				cv::line(m_displayResult, eyeCenters[0], exp1, extrapolatedLineColor, thickness);
+				m_resultOverlay.Line(eyeCenters[0], exp1, extrapolatedLineColor, thickness);
 
 				cv::Point2f exp2(utils::lerp(eyeCenters[1].x, eyeCenters[0].x, interpParam),
 					utils::lerp(eyeCenters[1].y, eyeCenters[0].y, interpParam));
 
-				cv::line(m_displayResult, eyeCenters[1], exp2, extrapolatedLineColor, thickness);
+				m_resultOverlay.Line(eyeCenters[1], exp2, extrapolatedLineColor, thickness);
 
 					
 			}
 		}
 
-		if (m_params.drawHorizontalEyesLineOriginal && eyesDetectionFailed == false && m_params.NeedToHaveDisplayedImage())
+		if (PC_FEATURE_DISPLAY && m_params.drawHorizontalEyesLineOriginal && eyesDetectionFailed == false && m_params.NeedToHaveDisplayedImage())
 		{
-			static cv::Scalar horizontLineColor(232, 162, 0);
+			const cv::Scalar horizontLineColor(232, 162, 0);
 
 			assert(eyeCenters.size() >= 1);
 
 			float horizont = eyeCenters[0].y;
-			cv::line(m_displayResult, cv::Point2f(0.f, horizont), cv::Point2f(float(m_displayResult.cols), horizont), horizontLineColor, 1);
+			m_resultOverlay.Line(cv::Point2f(0.f, horizont), cv::Point2f(float(m_resizedImage.cols), horizont), horizontLineColor, 1);
 		}
 	}
 		
@@ -377,9 +982,9 @@ void ProcessorImpl::processImpl()
 	{
 		for (size_t i = 0; i < m_faces.size(); ++i)
 		{
-			static cv::Scalar color(181, 230, 29);
+			const cv::Scalar color(181, 230, 29);
 			cv::Scalar x = color / double(m_faces.size() + 1);
-			cv::rectangle(m_displayResult, m_faces[i], x * double(m_faces.size() - (i - 1)), 5);
+			m_resultOverlay.Rectangle(m_faces[i], x * double(m_faces.size() - (i - 1)), 5);
 		}
 	}
 
@@ -390,15 +995,15 @@ void ProcessorImpl::processImpl()
 		else
 			m_box.angle = rotate(eyeCenters);
 			
-		pc::Log::get().Write(std::string("Rotation angle is ") + std::to_string(m_box.angle), pc::LogLevel::Info);
+		LOG_WRITE(std::string("Rotation angle is ") + std::to_string(m_box.angle), pc::LogLevel::Info);
 
-		if (m_params.drawHorizontalEyesLineResult && m_params.NeedToHaveDisplayedImage())
+		if (PC_FEATURE_DISPLAY && m_params.drawHorizontalEyesLineResult && m_params.NeedToHaveDisplayedImage())
 		{
-			static cv::Scalar horizontLineColor(0, 252, 255);
+			const cv::Scalar horizontLineColor(0, 252, 255);
 
 			assert(eyeCenters.size() >= 1);
 			float horizont = eyeCenters[0].y;
-			cv::line(m_displayResult, cv::Point2f(0.f, horizont), cv::Point2f(float(m_displayResult.cols), horizont), horizontLineColor, 1);
+			m_resultOverlay.Line(cv::Point2f(0.f, horizont), cv::Point2f(float(m_resizedImage.cols), horizont), horizontLineColor, 1);
 		}
 	}
 
@@ -440,10 +1045,10 @@ void ProcessorImpl::processImpl()
 		
 	// TODO draw only if corresponding flag is turned on
 	//lines of lips and face bottom
-	cv::line(m_displayOrigin, cv::Point2f((float)m_box.minx, (float)lipsY),
+	m_originOverlay.Line(cv::Point2f((float)m_box.minx, (float)lipsY),
 		cv::Point2f(255.f, (float)lipsY), cv::Scalar(255.f, 255.f, 255.f), 2);
 
-	cv::line(m_displayOrigin, cv::Point2f((float)m_box.minx, (float)faceBottomY),
+	m_originOverlay.Line(cv::Point2f((float)m_box.minx, (float)faceBottomY),
 		cv::Point2f(255.f, (float)faceBottomY), cv::Scalar(255.f, 255.f, 255.f), 2);
 
 	if (m_params.needCrop && m_faces.empty() == false)
@@ -452,62 +1057,25 @@ void ProcessorImpl::processImpl()
 	}
 }
 
-void ProcessorImpl::applyRotation()
-{
-	// apply rotation image readed from config
-
-	try
-	{
-		if (m_params.rotateImage)
-		{
-			int orient = 1;
-
-			int degree = (m_params.rotateDegree >= 0 ? 1 : -1) * std::abs(m_params.rotateDegree) % 360;
-			switch (degree)
-			{
-			case 90:
-				orient = 6; break;
-			case -90:
-				orient = 8; break;
-			case 180:
-			case -180:
-				orient = 3; break;
-			case 270:
-				orient = 3; applyExifOrientation(orient); orient = 6; break;
-			case -270:
-				orient = 3; applyExifOrientation(orient); orient = 8; break;
-			default:
-				break;
-			}
-
-			applyExifOrientation(orient);
-		}
-	}
-	catch (const std::exception&)
-	{
-		const char* msg = "fail when trying to rotation taken from settings file";
-		pc::Log::get().Write(msg, pc::LogLevel::Warning);
-		m_stats.AddWarning(stats::Info(m_filename, msg));
-	}
-}
-
 int ProcessorImpl::proofOrientation()
 {
 	// check if image has invalid meta orientation tag
 	// and have been rotated to a wrong degree
 	if (m_originImage.rows < m_originImage.cols)
 	{
-		cv::Mat hsv = m_originImage.clone();
-
-		cv::cvtColor(m_originImage, hsv, CV_BGR2HSV);
+		// NOTE only middle row is checked, so only it is converted
+		cv::Mat hsv;
+		cv::cvtColor(m_originImage.row(m_originImage.rows / 2), hsv, CV_BGR2HSV);
 
 		cv::Mat binary;
 		cv::inRange(hsv, cv::Scalar(0, 0, 0), cv::Scalar(255, 30, 255), binary);
 
+		const int rows = m_originImage.rows;
+
 		int lenght = 0;
 		for (int i = 0; i < binary.cols; i++)
 		{
-			uchar pix = binary.at<uchar>(binary.rows / 2, i);
+			uchar pix = binary.at<uchar>(0, i);
 			if (pix == 255)
 			{
 				lenght++;
@@ -516,13 +1084,13 @@ int ProcessorImpl::proofOrientation()
 				break;
 		}
 
-		if (lenght > binary.rows * 12 / 100)
+		if (lenght > rows * 12 / 100)
 			return 1; // turn right
 
 		lenght = 0;
 		for (int i = binary.cols - 1; i >= 0; i--)
 		{
-			uchar pix = binary.at<uchar>(binary.rows / 2, i);
+			uchar pix = binary.at<uchar>(0, i);
 			if (pix == 255)
 			{
 				lenght++;
@@ -530,7 +1098,7 @@ int ProcessorImpl::proofOrientation()
 			else
 				break;
 		}
-		if (lenght > binary.rows * 12 / 100)
+		if (lenght > rows * 12 / 100)
 			return -1; // turn left			
 	}
 	return 0;
@@ -538,10 +1106,12 @@ int ProcessorImpl::proofOrientation()
 
 std::vector<cv::Point2f> ProcessorImpl::detectEyes()
 {
+	utils::StageTimer timer(m_stats, stats::Stage::EyesDetection);
+
 	static const int faceIndex = 0;
 	assert(faceIndex < m_faces.size());
 
-	cv::Mat imageFace(m_resizedImageGrayscale, m_faces[faceIndex]);
+	cv::Mat imageFace(m_planes.Gray(), m_faces[faceIndex]);
 	m_cascadeEye->detectMultiScale(imageFace, m_eyes, 1.3, 7, 0, cv::Size(50, 50));
 
 	std::vector<cv::Point2f> points;
@@ -561,8 +1131,8 @@ std::vector<cv::Point2f> ProcessorImpl::detectEyes()
 		eyeRect.x += m_faces[faceIndex].x;
 		eyeRect.y += m_faces[faceIndex].y;
 
-		cv::Mat eye = m_resizedImage(eyeRect);
-		cv::cvtColor(eye, eye, CV_BGR2HSV);
+		// NOTE only region of eye is converted
+		cv::Mat eye = m_planes.Hsv(eyeRect);
 
 		cv::Mat binaryEye;
 		cv::inRange(eye, cv::Scalar(0, 0, 0), cv::Scalar(254, 255, 20), binaryEye);
@@ -609,29 +1179,91 @@ std::vector<cv::Point2f> ProcessorImpl::detectEyes()
 
 void ProcessorImpl::processOriginalImage()
 {
-	if (IsValid() && m_params.needEyeHorizontalCorrection)
+	utils::StageTimer timer(m_stats, stats::Stage::Transform);
+
+	// NOTE border, orientation, rotation by eyes line and crop are made by one affine transformation,
+	// which is evaluated only for pixels of result image
+	cv::Matx33d rotation = cv::Matx33d::eye();
+	cv::Rect rect(cv::Point(0, 0), m_preparedSize);
+
+	bool rotated = IsValid() && m_params.needEyeHorizontalCorrection && m_box.angle != 0.0f;
+	if (rotated)
 	{
-		cv::Mat rotMat = cv::getRotationMatrix2D(
+		// TODO maybe need to rotate around face center instead of image center?
+		rotation = affineToTransform(cv::getRotationMatrix2D(
 			cv::Size2f(
-				m_originImage.size().width * 0.5f,
-				m_originImage.size().height * 0.5f
+				m_preparedSize.width * 0.5f,
+				m_preparedSize.height * 0.5f
 			),
-			m_box.angle, 1.f);
-
-		// TODO maybe need to rotate around face center instead of image center?
-		cv::Mat tmp = m_originImage;
-		cv::warpAffine(tmp, m_originImage, rotMat, m_originImage.size(), cv::INTER_LINEAR,
-			cv::BORDER_CONSTANT, cv::Scalar(255, 255, 255));
+			m_box.angle, 1.f));
 	}
 
 	if (IsValid() && m_params.needCrop)
 	{
-		crop(m_originImage);
+		rect = getCropRect(m_preparedSize);
 	}
+
+	// from result image to prepared and rotated one
+	cv::Matx33d toRotated = translateTransform(rect.x, rect.y);
+
+	cv::Matx33d transform = m_prepareTransform.inv() * rotation.inv() * toRotated;
+
+	// without rotation all pixels are mapped exactly
+	cv::Mat result;
+	m_matPool.Attach(result);
+	cv::warpAffine(m_originImage, result, transformToAffine(transform), rect.size(),
+		(rotated ? cv::INTER_LINEAR : cv::INTER_NEAREST) | cv::WARP_INVERSE_MAP, cv::BORDER_REPLICATE);
+
+	if (rotated)
+	{
+		// pixels outside of prepared image are white
+		cv::Matx33d toResult = toRotated.inv() * rotation;
+
+		const cv::Point2d canvas[4] = {
+			cv::Point2d(-0.5, -0.5),
+			cv::Point2d(m_preparedSize.width - 0.5, -0.5),
+			cv::Point2d(m_preparedSize.width - 0.5, m_preparedSize.height - 0.5),
+			cv::Point2d(-0.5, m_preparedSize.height - 0.5)
+		};
+
+		std::vector<cv::Point> polygon;
+		for (const cv::Point2d& corner : canvas)
+		{
+			cv::Vec3d p = toResult * cv::Vec3d(corner.x, corner.y, 1.0);
+			polygon.push_back(cv::Point(cvRound(p[0]), cvRound(p[1])));
+		}
+
+		const cv::Point resultCorners[4] = {
+			cv::Point(0, 0),
+			cv::Point(result.cols - 1, 0),
+			cv::Point(result.cols - 1, result.rows - 1),
+			cv::Point(0, result.rows - 1)
+		};
+
+		bool inside = true;
+		for (const cv::Point& corner : resultCorners)
+			inside = inside && cv::pointPolygonTest(polygon, corner, false) >= 0.0;
+
+		if (inside == false)
+		{
+			cv::Mat outside;
+			m_matPool.Attach(outside);
+			outside.create(result.size(), CV_8UC1);
+			outside.setTo(cv::Scalar(255));
+			cv::fillConvexPoly(outside, polygon, cv::Scalar(0));
+
+			result.setTo(cv::Scalar(255, 255, 255), outside);
+		}
+	}
+
+	m_originImage = result;
+	m_resultSize = result.size();
 }
 
 float ProcessorImpl::rotate(std::vector<cv::Point2f>& eyeCenters)
 {
+	utils::StageTimer timer(m_stats, stats::Stage::Rotation);
+
 	assert(eyeCenters.size() >= 2);
 
 	static const float PI = 3.14159265358979323846F;
@@ -649,29 +1281,33 @@ float ProcessorImpl::rotate(std::vector<cv::Point2f>& eyeCenters)
 		cv::Size2f(m_resizedImage.size().width * 0.5f, m_resizedImage.size().height * 0.5f),
 		angle, 1.f);
 
+	// NOTE rotated image is written to new buffer, source can be referred by debug overlays
 	cv::Mat tmp = m_resizedImage;
+	m_resizedImage = cv::Mat();
+	m_matPool.Attach(m_resizedImage);
 
 	// TODO maybe need to rotate around face center instead of image center?
-	cv::warpAffine(tmp, m_resizedImage, rotationMat, m_resizedImage.size(), cv::INTER_LINEAR,
+	cv::warpAffine(tmp, m_resizedImage, rotationMat, tmp.size(), cv::INTER_LINEAR,
 		cv::BORDER_CONSTANT, cv::Scalar(255, 255, 255));
 
-	tmp = m_displayResult;
-	// TODO maybe need to rotate around face center instead of image center?
-	cv::warpAffine(tmp, m_displayResult, rotationMat, m_displayResult.size(), cv::INTER_LINEAR,
-		cv::BORDER_CONSTANT, cv::Scalar(255, 255, 255));
+	m_resultOverlay.Warp(rotationMat);
 
-	// update gray-scale image
-	cv::cvtColor(m_resizedImage, m_resizedImageGrayscale, cv::COLOR_RGB2GRAY);
+	// planes of rotated image are computed again when they are needed
+	m_planes.Reset(m_resizedImage);
 
 	return angle;
 }
 
 void ProcessorImpl::contours(int hight)
 {
+	utils::StageTimer timer(m_stats, stats::Stage::Contours);
+
 	if (m_faces.size() < 1 || m_eyes.size() < 2)
 		return;
 
-	int newHeight = m_resizedImageGrayscale.cols;
+	cv::Mat grayscale = m_planes.Gray();
+
+	int newHeight = grayscale.cols;
 
 	// TODO     c    newHeight
 	// case 1:    
@@ -685,68 +1321,22 @@ void ProcessorImpl::contours(int hight)
 	}		
 
 	//    (    ,     )
-	cv::Mat tmp = m_resizedImageGrayscale(
-		cv::Rect(0, 0, m_resizedImageGrayscale.cols, newHeight));
+	newHeight = min(newHeight, grayscale.rows);
 
-	cv::Mat threshMat;
-	cv::threshold(tmp, threshMat, m_params.siholetteBrightnessThreshold, 255, CV_THRESH_BINARY_INV);
-				
 	int& minx = m_box.minx;
 	int& maxx = m_box.maxx;
 	int& miny = m_box.miny;
 
-	minx = threshMat.cols;
-	maxx = 0;
-	miny = threshMat.rows;
-
 	//      , , 
-	for (int i = 0; i < threshMat.rows; ++i)
-	{
-		size_t elemSize = threshMat.elemSize();
-		uchar* r = (uchar*)(threshMat.data + i * elemSize * threshMat.cols);
-			
-		for (int j = 0; j < threshMat.cols; ++j)
-		{
-			if (r[j] > 0)
-			{
-				minx = min(minx, j);
-				miny = min(miny, i);
-
-				// break   - ,     
-			}
-		}
-
-		for (int j = threshMat.cols - 1; j >= 0; --j)
-		{
-			if (r[j] > 0)
-			{
-				maxx = max(maxx, j);
-				miny = min(miny, i);
-
-				//  , 
-				break;
-			}
-		}
-	}
-
-	if (maxx == 0)
-		maxx = threshMat.cols;
-		
-	int stepx = int(float(threshMat.cols) * m_params.cropRelativeScaleX);
-	int stepy = int(float(threshMat.rows) * m_params.cropRelativeScaleY);
-
-	minx = max(0, minx - stepx);
-	maxx = min(threshMat.cols, maxx + stepx);
-	miny = max(0, miny - stepy);
-
+	silhouetteExtents(newHeight);
 		
 	// calc image size with respect of aspect ration
-	calcAspectRatio(m_box, m_resizedImageGrayscale, hight);
-	horizontalRatio(m_box, m_resizedImageGrayscale);
+	calcAspectRatio(m_box, grayscale, hight);
+	horizontalRatio(m_box, grayscale);
 
 	assert(minx >= 0 && minx < maxx);
-	assert(maxx <= threshMat.cols);
-	assert(miny >= 0 && miny < threshMat.rows);
+	assert(maxx <= grayscale.cols);
+	assert(miny >= 0 && miny < newHeight);
 	// check aspect ratio
 	//assert(minx + maxx);
 		
@@ -765,15 +1355,13 @@ void ProcessorImpl::contours(int hight)
 		
 	m_resizedImage = m_resizedImage(cv::Rect(minx, miny, m_box.width(), m_box.height()));
 
-	// update grayscale image
-	m_resizedImageGrayscale = m_resizedImageGrayscale(cv::Rect(minx, miny, m_box.width(), m_box.height()));
-	m_displayResult = m_displayResult(cv::Rect(minx, miny, m_box.width(), m_box.height()));						
+	// update planes
+	m_planes.Crop(cv::Rect(minx, miny, m_box.width(), m_box.height()));
+	m_resultOverlay.Crop(cv::Rect(minx, miny, m_box.width(), m_box.height()));						
 }
 
-void ProcessorImpl::crop(cv::Mat& image)
+cv::Rect ProcessorImpl::getCropRect(const cv::Size& imageSize)
 {
-	cv::Mat tmp = image;
-
 	float xScaleReverse = 1.0f / m_box.xScale;
 	float yScaleReverse = 1.0f / m_box.yScale;
 
@@ -791,96 +1379,46 @@ void ProcessorImpl::crop(cv::Mat& image)
 	height = int(float(height)	* yScaleReverse);
 
 	// TODO     ,    
-	width = min(width, image.cols - x);
-	height = min(height, image.rows - y);
+	width = min(width, imageSize.width - x);
+	height = min(height, imageSize.height - y);
 
-	assert(x >= 0 && (x + width) <= image.cols);
-	assert(y >= 0 && (y + height) <= image.rows);
+	assert(x >= 0 && (x + width) <= imageSize.width);
+	assert(y >= 0 && (y + height) <= imageSize.height);
 
-	image = tmp(cv::Rect(x, y, width, height));
+	return cv::Rect(x, y, width, height);
 }
 
-void ProcessorImpl::applyExifOrientation(int orientation)
+void ProcessorImpl::readAndResetExifOrientation(const std::string &filename)
 {
-	// 1	top	left side
-	// 2	top	right side
-	// 3	bottom	right side
-	// 4	bottom	left side
-	// 5	left side	top
-	// 6	right side	top
-	// 7	right side	bottom
-	// 8	left side	bottom
-
-	//	   1        2       3      4         5            6           7          8
-	//	
-	//	888888  888888      88  88      8888888888  88                  88  8888888888
-	//	88          88      88  88      88  88      88  88          88  88      88  88
-	//	8888      8888    8888  8888    88          8888888888  8888888888          88
-	//	88          88      88  88
-	//	88          88  888888  888888
-
-	enum exifOrient
-	{
-		topleft = 1,
-		topright,
-		bottomright,
-		bottomleft,
-		lefttop,
-		righttop,
-		rightbottom,
-		leftbottom
-	};
+	// NOTE orientation is read by fast parser of file header, exiv2 is used only for unsupported formats.
+	// Full metadata is read by exiv2 later only if it's saved to result (see insertExif)
+	int orientation = 1;
 
-	cv::Mat copy = m_originImage;
-
-	switch (orientation)
-	{
-	case topleft:		// 1
-		// do nothing
-		break;
-	case topright:		// 2
-		// mirror vertically
-		cv::flip(copy, m_originImage, 1);
-		break;
-	case bottomright:	// 3
-		// mirror vertically and horizontally
-		cv::flip(copy, m_originImage, -1);
-		break;
-	case bottomleft:	// 4
-		// mirror horizontally
-		cv::flip(copy, m_originImage, 0);
-		break;
-
-	case righttop:	// 6
-		// rotate clockwise
-		cv::flip(m_originImage, copy, 0);
-		cv::transpose(copy, m_originImage);
-		break;
-	case leftbottom:	// 8
-		// rotate counter-clockwise
-		cv::flip(m_originImage, copy, 1);
-		cv::transpose(copy, m_originImage);
-		break;
-
-	case rightbottom:	// 7
-	case lefttop:		// 5
-		// transpose
-		cv::transpose(copy, m_originImage);
-		break;
-	default:
-		break;
-	}
+	utils::ImageHeader header;
+	if (m_fileData.empty() == false && utils::readImageHeader(&m_fileData[0], m_fileData.size(), header))
+		orientation = header.orientation;
+	else
+		orientation = readExifData(filename);
+
+	if (orientation != 1)
+		LOG_WRITE("exif orientation is " + std::to_string(orientation), Info);
+
+	m_exifOrientation = orientation;
 }
-	
-void ProcessorImpl::applyAndResetExifRotation(const std::string &filename)
+
+int ProcessorImpl::readExifData(const std::string &filename)
 {
 	//    exif( jpeg  jfif). 
-	//     
+	//   (   getPrepareTransform)
 	//       
+	int orientation = 1;
 
 	try
 	{
-		Exiv2::Image::AutoPtr image = Exiv2::ImageFactory::open(filename.c_str());
+		// file is already read to memory, so it isn't opened second time
+		Exiv2::Image::AutoPtr image = m_fileData.empty()
+			? Exiv2::ImageFactory::open(filename.c_str())
+			: Exiv2::ImageFactory::open(&m_fileData[0], long(m_fileData.size()));
 		assert(image.get() != 0);
 
 		image->readMetadata();
@@ -895,12 +1433,7 @@ void ProcessorImpl::applyAndResetExifRotation(const std::string &filename)
 			{
 				Exiv2::Exifdatum& data = *it;
 
-				long orientation = data.value().toLong();
-
-				if (orientation != 1)
-					pc::Log::get().Write("exif orientation is " + std::to_string(orientation), Info);
-
-				applyExifOrientation(orientation);
+				orientation = int(data.value().toLong());
 
 				// TODO check that photo is really turned like we want
 
@@ -929,29 +1462,64 @@ void ProcessorImpl::applyAndResetExifRotation(const std::string &filename)
 		pc::Log::get().Write(msg, pc::LogLevel::Warning);
 		m_stats.AddWarning(stats::Info(m_filename, msg));
 	};
+
+	return orientation;
 }
 
-void ProcessorImpl::saveExif(const std::string &newFilename)
+void ProcessorImpl::insertExif(std::vector<unsigned char>& encoded)
 {
-	// TODO need to update width and height in exif metadata?
+	if (encoded.empty())
+		return;
+
+	utils::StageTimer timer(m_stats, stats::Stage::WriteExif);
 
-	if (m_exifData.get())
+	if (m_params.preserveExif == false)
 	{
-		try
-		{
-			// write exif metadata to image
-			Exiv2::Image::AutoPtr image = Exiv2::ImageFactory::open(newFilename.c_str());
-			assert(image.get() != nullptr);
+		// metadata which is copied by lossless transformation mustn't rotate result once more
+		utils::resetExifOrientation(&encoded[0], encoded.size());
+		return;
+	}
 
-			image->setExifData(*m_exifData.get());
-			image->writeMetadata();
-		}
-		catch (std::exception&)
-		{
-			std::string msg = "failed when trying to write exif metadata to new file " + newFilename;
-			pc::Log::get().Write(msg, pc::LogLevel::Warning);
-			m_stats.AddWarning(stats::Info(m_filename, msg));
-		}
+	if (m_exifData.get() == nullptr)
+		readExifData(m_filename);
+
+	if (m_exifData.get() == nullptr)
+		return;
+
+	try
+	{
+		// size of image is changed by crop and orientation
+		Exiv2::ExifData::iterator width = m_exifData->findKey(Exiv2::ExifKey("Exif.Photo.PixelXDimension"));
+		if (width != m_exifData->end())
+			*width = uint32_t(m_resultSize.width);
+
+		Exiv2::ExifData::iterator height = m_exifData->findKey(Exiv2::ExifKey("Exif.Photo.PixelYDimension"));
+		if (height != m_exifData->end())
+			*height = uint32_t(m_resultSize.height);
+
+		// write exif metadata to encoded image in memory
+		Exiv2::Image::AutoPtr image = Exiv2::ImageFactory::open(&encoded[0], long(encoded.size()));
+		assert(image.get() != nullptr);
+
+		image->setExifData(*m_exifData.get());
+		image->writeMetadata();
+
+		Exiv2::BasicIo& io = image->io();
+		io.open();
+
+		Exiv2::DataBuf data = io.read(io.size());
+		io.close();
+
+		if (data.size_ <= 0)
+			throw std::exception();
+
+		encoded.assign(data.pData_, data.pData_ + data.size_);
+	}
+	catch (std::exception&)
+	{
+		std::string msg = "failed when trying to write exif metadata to new file";
+		pc::Log::get().Write(msg, pc::LogLevel::Warning);
+		m_stats.AddWarning(stats::Info(m_filename, msg));
 	}
 }
 
@@ -965,7 +1533,7 @@ void ProcessorImpl::calcAspectRatio(pc::utils::Box& data, cv::Mat& resizedImage,
 
 	if (shrinkVertically)
 	{
-		pc::Log::get().Write("Need to shrink image for correct aspect ratio", pc::LogLevel::Info);
+		LOG_WRITE("Need to shrink image for correct aspect ratio", pc::LogLevel::Info);
 
 		data.miny = 0;
 		height = resizedImage.rows;
@@ -989,9 +1557,9 @@ void ProcessorImpl::calcAspectRatio(pc::utils::Box& data, cv::Mat& resizedImage,
 		if (data.miny + height > resizedImage.rows)
 			data.miny = resizedImage.rows - height;
 
-		cv::line(m_displayOrigin, cv::Point2f((float)m_box.minx, (float)data.miny),
+		m_originOverlay.Line(cv::Point2f((float)m_box.minx, (float)data.miny),
 			cv::Point2f(255.f, (float)data.miny), cv::Scalar(0.f, 0.f, 255.f), 2);
-		cv::line(m_displayOrigin, cv::Point2f((float)m_box.minx, (float)data.maxy),
+		m_originOverlay.Line(cv::Point2f((float)m_box.minx, (float)data.maxy),
 			cv::Point2f(255.f, (float)data.maxy), cv::Scalar(0.f, 0.f, 255.f), 2);
 	}		
 }
@@ -1016,6 +1584,7 @@ void ProcessorImpl::tryToSaveResultImageToDisplayToFile()
 
 		pc::utils::filesystem::createDir(m_params.copyResultImageWhenFailedFolder);
 
+#if PC_FEATURE_DISPLAY
 		if (m_params.needToCopyResultImageWhenFailed)
 		{
 			std::string newFilePath = m_params.copyResultImageWhenFailedFolder + "/"
@@ -1026,7 +1595,7 @@ void ProcessorImpl::tryToSaveResultImageToDisplayToFile()
 				std::string msg = "save processed image with highlighted face detection result in " + newFilePath;
 				pc::Log::get().Write(msg, pc::LogLevel::Info);
 
-				bool result = cv::imwrite(newFilePath, m_displayResult);
+				bool result = cv::imwrite(newFilePath, m_resultOverlay.Render());
 
 				if (result == false)
 					throw std::exception();
@@ -1039,24 +1608,54 @@ void ProcessorImpl::tryToSaveResultImageToDisplayToFile()
 				m_stats.AddWarning(stats::Info(m_filename, msg));
 			}
 		}
+#endif
 
-		// TODO just copy file here using system default command
 		if (m_params.alsoCopyOriginalImageToFailedFolder)
 		{
 			std::string originFilePath = m_params.copyResultImageWhenFailedFolder + "/" + filenameFull;
 
-			try
+			std::string error;
+			if (pc::utils::filesystem::copyFile(m_filename, originFilePath, false, m_params.copyMode, &error) == false)
 			{
-				bool result = pc::utils::filesystem::copyFile(m_filename, originFilePath, false);
+				std::string msg = "failed when trying to copy original image to file " + originFilePath + ": " + error;
+
+				pc::Log::get().Write(msg, pc::LogLevel::Warning);
+				m_stats.AddWarning(stats::Info(m_filename, msg));
 			}
-			catch (std::exception&)
-			{ }
 		}
 	}
 }
 	
-int ProcessorImpl::findFaceBottom(cv::Mat& grayScaleImg, int startY)
+void ProcessorImpl::silhouetteExtents(int rows)
 {
+	const utils::ProjectionProfile& profile = m_planes.Silhouette(m_params.siholetteBrightnessThreshold, rows);
+
+	int& minx = m_box.minx;
+	int& maxx = m_box.maxx;
+	int& miny = m_box.miny;
+
+	if (profile.GetExtents(rows, minx, maxx, miny) == false)
+	{
+		minx = profile.Cols();
+		maxx = 0;
+		miny = rows;
+	}
+
+	if (maxx == 0)
+		maxx = profile.Cols();
+
+	int stepx = int(float(profile.Cols()) * m_params.cropRelativeScaleX);
+	int stepy = int(float(rows) * m_params.cropRelativeScaleY);
+
+	minx = max(0, minx - stepx);
+	maxx = min(profile.Cols(), maxx + stepx);
+	miny = max(0, miny - stepy);
+}
+
+int ProcessorImpl::findFaceBottom(const cv::Mat& grayScaleImg, int startY)
+{
+	utils::StageTimer timer(m_stats, stats::Stage::FaceBottom);
+
 	double middleValueForAll = 0;
 		
 	int startRow = grayScaleImg.rows * 10 / 100;
@@ -1066,86 +1665,20 @@ int ProcessorImpl::findFaceBottom(cv::Mat& grayScaleImg, int startY)
 	int endCol = grayScaleImg.cols * 80 / 100;
 
 	//     
-	for (int i = startRow; i < endRow; i++)
-	{
-		for (int j = startCol; j < endCol; j++)
-		{		
-			try
-			{
-				uchar bgrPixel = grayScaleImg.at<uchar>(i, j);
-				middleValueForAll += bgrPixel;
-			}
-			catch (std::exception ex)
-			{
-				//TODO
-			}
-		}
-	}
+	middleValueForAll = cv::sum(grayScaleImg(cv::Rect(startCol, startRow, endCol - startCol, endRow - startRow)))[0];
 		
 	middleValueForAll /= grayScaleImg.cols * grayScaleImg.rows;
 
 
-	int newHeight = m_resizedImageGrayscale.cols * 70 / 100;			
-
 	//    (    ,     )
-	cv::Mat tmp = m_resizedImageGrayscale(cv::Rect(0, 0, m_resizedImageGrayscale.cols, newHeight));
-
-	//    (  contours();)
-	cv::Mat threshMat;
-	cv::threshold(tmp, threshMat, m_params.siholetteBrightnessThreshold, 255, CV_THRESH_BINARY_INV);
-
-	int& minx = m_box.minx;
-	int& maxx = m_box.maxx;
-	int& miny = m_box.miny;
-
-	minx = threshMat.cols;
-	maxx = 0;
-	miny = threshMat.rows;
-
-	//      , , 
-	for (int i = 0; i < threshMat.rows; ++i)
-	{
-		size_t xx = threshMat.elemSize();
-		uchar* r = (uchar*)(threshMat.data + i * xx * threshMat.cols);
-
-		for (int j = 0; j < threshMat.cols; ++j)
-		{
-			if (r[j] > 0)
-			{
-				minx = min(minx, j);
-				miny = min(miny, i);
-
-				// break   - ,   
-				//  
-			}
-		}
-
-		for (int j = threshMat.cols - 1; j >= 0; --j)
-		{
-			if (r[j] > 0)
-			{
-				maxx = max(maxx, j);
-				miny = min(miny, i);
-
-				//  , 
-				break;
-			}
-		}
-	}
-
-	if (maxx == 0)
-		maxx = threshMat.cols;
+	int newHeight = min(grayScaleImg.cols * 70 / 100, grayScaleImg.rows);
 
-	int stepx = int(float(threshMat.cols) * m_params.cropRelativeScaleX);
-	int stepy = int(float(threshMat.rows) * m_params.cropRelativeScaleY);
-
-	minx = max(0, minx - stepx);
-	maxx = min(threshMat.cols, maxx + stepx);
-	miny = max(0, miny - stepy);
+	//     (  contours())
+	silhouetteExtents(newHeight);
 		
-	assert(minx >= 0 && minx < maxx);
-	assert(maxx <= threshMat.cols);
-	assert(miny >= 0 && miny < threshMat.rows);
+	assert(m_box.minx >= 0 && m_box.minx < m_box.maxx);
+	assert(m_box.maxx <= grayScaleImg.cols);
+	assert(m_box.miny >= 0 && m_box.miny < newHeight);
 
 	m_box.maxy = m_box.miny + int(float(m_box.width()) * m_params.aspectRatio);
 
@@ -1153,38 +1686,36 @@ int ProcessorImpl::findFaceBottom(cv::Mat& grayScaleImg, int startY)
 	return findChin(middleValueForAll, grayScaleImg.cols / 2, startY, grayScaleImg);				
 }
 
-int ProcessorImpl::findChin(double middleValueForAll, int medianaX, int startY, cv::Mat grayScaleImg)
-{		
+int ProcessorImpl::findChin(double middleValueForAll, int medianaX, int startY, const cv::Mat& grayScaleImg)
+{
+	utils::StageTimer timer(m_stats, stats::Stage::Chin);
+
 	bool isFound = false;
 		
 	int hight = 0;
-	cv::line(m_displayResult, cv::Point2f((float)m_box.minx, (float)startY),
+	m_resultOverlay.Line(cv::Point2f((float)m_box.minx, (float)startY),
 		cv::Point2f((float)m_box.maxx, (float)startY), cv::Scalar(0.f, 255.f, 0.f), 2);
 
 	//   ,       		
-	for (int i = startY; i < grayScaleImg.rows; i++)
-	{		
-		cv::line(m_displayOrigin, cv::Point2f(float(medianaX - 1), float(i)),
-			cv::Point2f(float(medianaX + 1), float(i)), cv::Scalar(0.f, 0.f, 255.f), 2);
-
-		try
-		{
-			hight = i;
-			uchar bgrPixel = grayScaleImg.at<uchar>(i, medianaX);
-			int pxl = bgrPixel;
-			if (pxl <= middleValueForAll)
-			{
-				isFound = true;
-				break;
-			}
-				
-		}
-		catch (std::exception ex)
-		{
-			//TODO
-		}
+	int found = utils::ProjectionProfile::FindInColumn(grayScaleImg, medianaX, startY, middleValueForAll);
+	if (found >= 0)
+	{
+		hight = found;
+		isFound = true;
+	}
+	else if (startY < grayScaleImg.rows)
+	{
+		// whole column is scanned
+		hight = grayScaleImg.rows - 1;
 	}
 				
+	// scanned part of middle column
+	if (hight >= startY)
+	{
+		m_originOverlay.Line(cv::Point2f(float(medianaX), float(startY)),
+			cv::Point2f(float(medianaX), float(hight)), cv::Scalar(0.f, 0.f, 255.f), 4);
+	}
+
 	int lowPartUnderMouth = grayScaleImg.rows - startY;
 	int lowPartUnderFB = -1 * ((grayScaleImg.rows - hight) - lowPartUnderMouth);
 
@@ -1209,47 +1740,75 @@ int ProcessorImpl::findChin(double middleValueForAll, int medianaX, int startY,
 }
 	
 int ProcessorImpl::findLips()
-{	
-	cv::Mat hsv = m_resizedImage.clone();
-	cv::cvtColor(m_resizedImage, hsv, CV_BGR2HSV);		
-		
-	cv::Mat binary;
-	cv::inRange(hsv, cv::Scalar(128, 128, 113), cv::Scalar(255, 230, 172), binary);
-				
-	cv::Mat res = binary;
-	cv::dilate(binary, res, cv::Mat(), cv::Point(-1, -1), 8, 1, 1);
-				
-	int startY = res.rows * 55 / 100;
-	int startX = res.cols * 30 / 100;
-	int endX = res.cols - startX;
+{
+	utils::StageTimer timer(m_stats, stats::Stage::Lips);
+
+	// lips are the first band of rows below startY which have lips color between startX and endX
+	// in mask dilated by 3x3 kernel 8 times (square of radius 8, border is replicated).
+	// Only presence of color in row is needed, so dilation is separable: horizontal one widens band of columns
+	// and vertical one is taken over presence in neighbour rows. Rows are checked by strips from top of band,
+	// so search is stopped right under lips and the rest of image isn't converted at all
+	static const int radius = 8;
+	static const int stripRows = 16;
+
+	const cv::Size size = m_resizedImage.size();
+
+	int startY = size.height * 55 / 100;
+	int startX = size.width * 30 / 100;
+	int endX = size.width - startX;
+
+	if (startY >= size.height)
+		return 0;
+
+	// no columns to check, band isn't ended
+	if (startX >= endX)
+		return size.height - 1;
+
+	cv::Range cols(max(0, startX - radius), min(size.width, endX + radius));
 
-	int lipsY = 0;
+	std::vector<char> hasColor(size.height, 0);
+	int checkedY = max(0, startY - radius);
+	int count = 0; // rows with color in [y - radius, y + radius]
 
-	bool exDetected = false;
-	bool isRun = true;
+	cv::Mat strip;
+	bool inBand = false;
 
-	for (int i = startY; i < res.rows; i++)
+	for (int y = startY; y < size.height; ++y)
 	{
-		if (!isRun)
-			break;
+		int windowEnd = min(size.height, y + radius + 1);
 
-		lipsY = i;
-		for (int j = startX; j < endX; j++)
+		while (checkedY < windowEnd)
 		{
-			uchar bgrPixel = res.at<uchar>(i, j);
-			if (bgrPixel == 255)
-			{					
-				exDetected = true;
-				break;
-			}
-			else if (j == endX - 1 && exDetected)
-			{
-				isRun = false;
-			}
+			int stripEnd = min(size.height, checkedY + stripRows);
+			cv::inRange(m_planes.Hsv(cv::Rect(cols.start, checkedY, cols.size(), stripEnd - checkedY)),
+				cv::Scalar(128, 128, 113), cv::Scalar(255, 230, 172), strip);
+
+			for (int i = 0; i < strip.rows; ++i)
+				hasColor[checkedY + i] = utils::ProjectionProfile::FirstNonZero(strip.ptr<uchar>(i), strip.cols) >= 0;
+
+			checkedY = stripEnd;
 		}
+
+		if (y == startY)
+		{
+			for (int i = max(0, y - radius); i < windowEnd; ++i)
+				count += hasColor[i];
+		}
+		else
+		{
+			if (y + radius < size.height)
+				count += hasColor[y + radius];
+			if (y - radius - 1 >= 0)
+				count -= hasColor[y - radius - 1];
+		}
+
+		if (count > 0)
+			inBand = true;
+		else if (inBand)
+			return y;
 	}
 
-	return lipsY;
+	return size.height - 1;
 }
 
 }
\ No newline at end of file
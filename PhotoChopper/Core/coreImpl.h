@@ -3,6 +3,9 @@
 #include "../utils/statistics.h"
 #include "../utils/parameters.h"
 #include "../utils/box.h"
+#include "../utils/matPool.h"
+#include "../utils/debugOverlay.h"
+#include "../utils/planeCache.h"
 
 #include <opencv2/objdetect.hpp>
 
@@ -13,15 +16,23 @@ namespace Exiv2
 
 namespace pc
 {
+
+namespace bench
+{
+	class StageBenchmark;
+}
 	
 // internal class
 class ProcessorImpl
 {
+	// runs stages separately
+	friend class bench::StageBenchmark;
+
 	typedef std::auto_ptr<Exiv2::ExifData> TExifDataPtr;
 	typedef std::vector<cv::Rect> TRegions;
 
 public:
-	ProcessorImpl(const utils::Parameters& params = utils::Parameters());
+	ProcessorImpl(const utils::Parameters& params = utils::Parameters(), utils::Statistics* statistics = nullptr);
 	~ProcessorImpl();
 
 	void Open(const std::string& filename);
@@ -32,39 +43,65 @@ public:
 	void Save();
 	void SaveAs(const std::string& newFilename);
 
+	// stages of SaveAs: geometry transforms of original image and encoding to file
+	void ProcessOriginal();
+	void Write(const std::string& newFilename);
+
 	bool IsValid();
 
 	void ShowOrigin();
 	void ShowResult();
 
 	inline utils::Statistics& GetStatistics() { return m_stats; }
+
+	// results of current image; coordinates are in resized image (see scales of box)
+	inline const utils::Box& GetBox() const { return m_box; }
+	inline const std::vector<cv::Rect>& GetFaces() const { return m_faces; }
+	inline const std::vector<cv::Rect>& GetEyes() const { return m_eyes; }
 	
 private:
 
 	void  reset();
+
+	// storage of image mats is taken from MatPool, so buffers are reused by next images
+	void  attachMatPool();
 		
 	void  processImpl();
 	void  processOriginalImage();
 
 	float rotate(std::vector<cv::Point2f>& eyeCenters);
-	void  crop(cv::Mat& face);
+	cv::Rect getCropRect(const cv::Size& imageSize);
 	void  contours(int hight);
 
 	void  horizontalRatio(pc::utils::Box& data, cv::Mat& resizedImage);
 	void  calcAspectRatio(pc::utils::Box& data, cv::Mat& resizedImage, int concurrentHight);
 
-	void  saveExif(const std::string &newFilename);
-	void  applyExifOrientation(int orientation);
+	void  insertExif(std::vector<unsigned char>& encoded);
+
+	int   findFaceBottom(const cv::Mat& grayScaleImg, int startY);
 
-	int   findFaceBottom(cv::Mat& grayScaleImg, int startY);
+	// bounds of dark silhouette in rows [0, rows) of resized image with margins from settings, written to m_box
+	void  silhouetteExtents(int rows);
 	int   findFaceBottomMirror(cv::Mat& grayScaleImg);
 	int   findLips();
 
-	int   findChin(double middleValueForAll, int x, int y, cv::Mat grayScaleImg);
+	int   findChin(double middleValueForAll, int x, int y, const cv::Mat& grayScaleImg);
 	void  tryToSaveResultImageToDisplayToFile();
 	
-	void  applyRotation();
-	void  applyAndResetExifRotation(const std::string &filename);
+	void  readAndResetExifOrientation(const std::string &filename);
+	int   readExifData(const std::string &filename);
+
+	void  readFileData();
+	bool  decodeJpeg(cv::Mat& image, float minScale, cv::Size* originSize);
+	void  decodeOriginImage();
+	void  ensureOriginImage();
+	bool  transformJpegLossless();
+
+	int   getBorderSize(const cv::Size& originSize);
+
+	// transformations of pixel coordinates, size is updated to size of transformed image
+	cv::Matx33d getRotationTransform(cv::Size& size);
+	cv::Matx33d getPrepareTransform(const cv::Size& originSize, cv::Size& preparedSize);
 
 	cv::Point findEyeCenter(cv::Mat face, cv::Rect eye, std::string debugWindow);
 	std::vector<cv::Point2f> detectEyes();
@@ -73,19 +110,41 @@ private:
 	
 private:
 	utils::Parameters m_params;
-	utils::Statistics m_stats;
+	utils::Statistics  m_ownStats;
+	utils::Statistics& m_stats; // own or shared with other processors
+	utils::MatPool&	   m_matPool;
 	TExifDataPtr m_exifData;
 
 	std::string m_filename;
 	utils::Box m_box;
 
+	std::vector<unsigned char> m_fileData;
+	int   m_exifOrientation;
+
+	utils::Timer m_imageTimer; // whole processing time of current image
+	long long	 m_traceStart;
+
+	cv::Size m_originSize;
+	size_t	 m_bytesWritten;
+	void* m_jpegDecompressor; // tjhandle
+	void* m_jpegTransformer;  // tjhandle
+
+	// result jpeg when it's made by lossless transformation of original file
+	std::vector<unsigned char> m_losslessData;
+	cv::Size m_resultSize;
+
 	cv::Ptr<cv::CascadeClassifier> m_cascadeFrontalFace;
 	cv::Ptr<cv::CascadeClassifier> m_cascadeEye;
 
+	// NOTE origin image is kept as decoded, border, orientation and rotation are applied
+	// only once to result image (see processOriginalImage)
 	cv::Mat m_originImage;
 
+	cv::Size	m_preparedSize;		// size of full image after border, orientation and rotation from settings
+	cv::Matx33d m_prepareTransform; // from decoded full image to prepared one
+
 	cv::Mat m_resizedImage;
-	cv::Mat m_resizedImageGrayscale;
+	utils::PlaneCache m_planes; // grayscale and HSV of resized image
 
 	bool	m_isOpen;
 	bool	m_success;
@@ -95,10 +154,9 @@ private:
 	TRegions m_faces;
 	TRegions m_eyes;
 
-	// for display
-	// TOOD refactor
-	cv::Mat m_displayOrigin;
-	cv::Mat m_displayResult;
+	// debug drawings over resized image, they are rendered only for window or failure image
+	utils::DebugOverlay m_originOverlay;
+	utils::DebugOverlay m_resultOverlay;
 };
 
 }
\ No newline at end of file
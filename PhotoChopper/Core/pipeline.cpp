@@ -0,0 +1,232 @@
+#include "pipeline.h"
+#include "core.h"
+
+#include <windows.h>
+
+#include "../utils/log.h"
+#include "../utils/trace.h"
+
+namespace // anonymous
+{
+	// time of waiting for previous stage is shown in trace
+	template <typename T>
+	bool popTraced(pc::utils::BoundedQueue<T>& queue, T& value, pc::utils::TraceRecorder* trace, const char* name)
+	{
+		pc::utils::TraceScope scope(trace, name, "wait");
+		return queue.Pop(value);
+	}
+
+	int stageWorkers(int count)
+	{
+		return max(1, count);
+	}
+
+	size_t jobsCount(const pc::utils::Parameters& params)
+	{
+		// every worker is busy with one job and every queue can be full
+		int workers = stageWorkers(params.pipelineDecodeWorkers) + stageWorkers(params.pipelineDetectWorkers)
+			+ stageWorkers(params.pipelineGeometryWorkers) + stageWorkers(params.pipelineEncodeWorkers);
+
+		return size_t(workers + 3 * params.pipelineQueueSize);
+	}
+} // namespace anonymous
+
+namespace pc
+{
+
+PipelineProcessor::PipelineProcessor(const utils::Parameters& params, utils::Statistics& stats)
+	: m_params(params)
+	, m_stats(stats)
+	, m_freeJobs(jobsCount(params))
+	, m_detectQueue(params.pipelineQueueSize)
+	, m_geometryQueue(params.pipelineQueueSize)
+	, m_encodeQueue(params.pipelineQueueSize)
+	, m_nextFile(0u)
+	, m_processedCount(0u)
+{ }
+
+PipelineProcessor::~PipelineProcessor()
+{ }
+
+size_t PipelineProcessor::Run(utils::filesystem::DirectoryScanner& files)
+{
+	size_t count = jobsCount(m_params);
+
+	for (size_t i = 0u; i < count; ++i)
+	{
+		std::unique_ptr<Job> job(new Job());
+		job->processor.reset(new Processor(m_params, &m_stats));
+		job->index = 0u;
+		job->failed = false;
+
+		m_freeJobs.Push(job.get());
+		m_jobs.push_back(std::move(job));
+	}
+
+	MSG_WRITE("use pipeline with " + std::to_string(stageWorkers(m_params.pipelineDecodeWorkers)) + " decode, "
+		+ std::to_string(stageWorkers(m_params.pipelineDetectWorkers)) + " detect, "
+		+ std::to_string(stageWorkers(m_params.pipelineGeometryWorkers)) + " geometry, "
+		+ std::to_string(stageWorkers(m_params.pipelineEncodeWorkers)) + " encode workers");
+
+	std::vector<std::thread> threads;
+
+	startStage(threads, stageWorkers(m_params.pipelineDecodeWorkers), &m_detectQueue,
+		[this, &files]() { decodeRoutine(files); });
+
+	startStage(threads, stageWorkers(m_params.pipelineDetectWorkers), &m_geometryQueue,
+		[this]() { stageRoutine(m_detectQueue, m_geometryQueue, &PipelineProcessor::detect); });
+
+	startStage(threads, stageWorkers(m_params.pipelineGeometryWorkers), &m_encodeQueue,
+		[this]() { stageRoutine(m_geometryQueue, m_encodeQueue, &PipelineProcessor::geometry); });
+
+	startStage(threads, stageWorkers(m_params.pipelineEncodeWorkers), nullptr,
+		[this]() { encodeRoutine(); });
+
+	for (auto& thread : threads)
+		thread.join();
+
+	return m_processedCount;
+}
+
+void PipelineProcessor::startStage(std::vector<std::thread>& threads, int workersCount, TJobQueue* output, const std::function<void()>& routine)
+{
+	// last finished worker of stage closes the queue to the next stage
+	std::shared_ptr<std::atomic<int>> alive = std::make_shared<std::atomic<int>>(workersCount);
+
+	for (int i = 0; i < workersCount; ++i)
+	{
+		threads.emplace_back([alive, output, routine]() {
+			try
+			{
+				routine();
+			}
+			catch (const std::exception& ex)
+			{
+				pc::Log::get().Write(std::string("unexpected error in pipeline worker: ") + ex.what(), pc::LogLevel::Error);
+			}
+
+			if (--(*alive) == 0 && output != nullptr)
+				output->Close();
+		});
+	}
+}
+
+void PipelineProcessor::decodeRoutine(utils::filesystem::DirectoryScanner& files)
+{
+	utils::filesystem::FileEntry file;
+
+	utils::TraceRecorder* trace = m_stats.GetTrace();
+
+	for (;;)
+	{
+		{
+			utils::TraceScope scope(trace, "waitForFile", "wait");
+			if (files.Next(file) == false)
+				break;
+		}
+
+		size_t index = m_nextFile++;
+
+		Job* job = nullptr;
+		if (popTraced(m_freeJobs, job, trace, "waitForFreeJob") == false)
+			break;
+
+		std::string path = file.GetPath();
+
+		job->file = file;
+		job->index = index;
+		job->failed = false;
+		job->log.clear();
+
+		pc::Log::SetThreadBuffer(&job->log);
+
+		MSG_WRITE(" :: " + std::to_string(index + 1u) + "/" + std::to_string(files.GetFoundCount()) + " file: " + path + " :: ");
+
+		try
+		{
+			job->processor->Open(path);
+		}
+		catch (const std::exception&)
+		{
+			job->failed = true;
+		}
+
+		pc::Log::SetThreadBuffer(nullptr);
+
+		m_detectQueue.Push(job);
+	}
+}
+
+void PipelineProcessor::stageRoutine(TJobQueue& input, TJobQueue& output, TStageFunc func)
+{
+	Job* job = nullptr;
+	while (popTraced(input, job, m_stats.GetTrace(), "waitForJob"))
+	{
+		if (job->failed == false)
+		{
+			pc::Log::SetThreadBuffer(&job->log);
+
+			try
+			{
+				(this->*func)(*job);
+			}
+			catch (const std::exception&)
+			{
+				job->failed = true;
+			}
+
+			pc::Log::SetThreadBuffer(nullptr);
+		}
+
+		output.Push(job);
+	}
+}
+
+void PipelineProcessor::encodeRoutine()
+{
+	Job* job = nullptr;
+	while (popTraced(m_encodeQueue, job, m_stats.GetTrace(), "waitForJob"))
+	{
+		pc::Log::SetThreadBuffer(&job->log);
+
+		if (job->failed == false)
+		{
+			try
+			{
+				encode(*job);
+			}
+			catch (const std::exception&)
+			{
+				job->failed = true;
+			}
+		}
+
+		job->processor->Close();
+
+		pc::Log::SetThreadBuffer(nullptr);
+		pc::Log::get().Flush(job->log);
+
+		++m_processedCount;
+
+		m_freeJobs.Push(job);
+	}
+}
+
+void PipelineProcessor::detect(Job& job)
+{
+	job.processor->Process();
+}
+
+void PipelineProcessor::geometry(Job& job)
+{
+	if (m_params.saveFiles)
+		job.processor->ProcessOriginal();
+}
+
+void PipelineProcessor::encode(Job& job)
+{
+	if (m_params.saveFiles)
+		job.processor->Write(utils::filesystem::getOutputPath(job.file.GetPath(), m_params.inputDirectory, m_params.outputDirectory));
+}
+
+}
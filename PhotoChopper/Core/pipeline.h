@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../utils/parameters.h"
+#include "../utils/statistics.h"
+#include "../utils/filesystem.h"
+#include "../utils/directoryScanner.h"
+#include "../utils/boundedQueue.h"
+#include "../utils/classutils.h"
+
+namespace pc
+{
+
+class Processor;
+
+// processes files by separate stages connected with bounded queues:
+//   decode (Open) -> detect (Process) -> geometry (ProcessOriginal) -> encode (Write, Close)
+// every stage has its own workers, so disk reads, detection and encoding overlap.
+// Processor of each file goes through all stages, count of processors is limited
+// so memory doesn't grow when one stage is slower than others
+class PipelineProcessor : public utils::noncopyable
+{
+public:
+	// all processors write to given statistics
+	PipelineProcessor(const utils::Parameters& params, utils::Statistics& stats);
+	~PipelineProcessor();
+
+	// returns count of processed files; can be called only once
+	size_t Run(utils::filesystem::DirectoryScanner& files);
+
+private:
+	struct Job
+	{
+		std::unique_ptr<Processor> processor;
+		utils::filesystem::FileEntry file;
+		size_t		index;
+		std::string log;
+		bool		failed;
+	};
+
+	typedef utils::BoundedQueue<Job*> TJobQueue;
+	typedef void (PipelineProcessor::*TStageFunc)(Job& job);
+
+	void startStage(std::vector<std::thread>& threads, int workersCount, TJobQueue* output, const std::function<void()>& routine);
+
+	void decodeRoutine(utils::filesystem::DirectoryScanner& files);
+	void stageRoutine(TJobQueue& input, TJobQueue& output, TStageFunc func);
+	void encodeRoutine();
+
+	void detect(Job& job);
+	void geometry(Job& job);
+	void encode(Job& job);
+
+private:
+	utils::Parameters m_params;
+	utils::Statistics& m_stats;
+
+	std::vector<std::unique_ptr<Job>> m_jobs;
+
+	TJobQueue m_freeJobs;
+	TJobQueue m_detectQueue;
+	TJobQueue m_geometryQueue;
+	TJobQueue m_encodeQueue;
+
+	std::atomic<size_t> m_nextFile;
+	std::atomic<size_t> m_processedCount;
+};
+
+}
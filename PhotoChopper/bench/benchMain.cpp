@@ -0,0 +1,263 @@
+#include <iostream>
+
+#include "../utils/parameters.h"
+#include "../utils/commandLine.h"
+#include "../utils/Log.h"
+#include "../utils/matPool.h"
+#include "benchmark.h"
+#include "stageBenchmark.h"
+#include "throughputBenchmark.h"
+#include "corpusGenerator.h"
+#include "regressionHarness.h"
+
+#include <vector>
+#include <sstream>
+
+#include <windows.h>
+
+// benchmarks are built to separate PhotoChopperBench.exe, production PhotoChopper.exe doesn't contain them
+
+enum RunMode
+{
+	RunNone,
+	RunStageBenchmark,
+	RunThroughputBenchmark,
+	RunGenerateCorpus,
+	RunRegression
+};
+
+void printUsage(const char* programName)
+{
+	std::cout << " Usage: " << programName << " -benchmark-stages [-s=<path to settings file>] [-benchmark-out=<json file>]" << std::endl;
+	std::cout << "            [-benchmark-filter=<part of case name>] [-benchmark-sizes=<megapixels, e.g. 2,12,24,50>] [-benchmark-min-time=<seconds>]" << std::endl;
+	std::cout << "        " << programName << " -benchmark-throughput [-i=<corpus dir>] [-o=<output_dir>] [-s=<path to settings file>] [-benchmark-out=<json file>]" << std::endl;
+	std::cout << "            [-benchmark-workers=<counts of workers, e.g. 1,2,4,8>] [-benchmark-warm-only]" << std::endl;
+	std::cout << "        " << programName << " -generate-corpus [-o=<output_dir>] [-s=<path to settings file>] [-corpus-sizes=<megapixels, e.g. 2,12>]" << std::endl;
+	std::cout << "            [-corpus-tilts=<degrees, e.g. -10,0,10>] [-corpus-orientations=<exif tags 1,3,6,8>] [-corpus-backgrounds=<relative to threshold, e.g. 90,20>]" << std::endl;
+	std::cout << "        " << programName << " -regression-record=<baseline file> | -regression-compare=<baseline file> [-i=<corpus dir>] [-o=<output_dir>] [-s=<path to settings file>]" << std::endl;
+	std::cout << "            [-regression-tolerance=<shift relative to face width>] [-regression-angle-tolerance=<degrees>] [-benchmark-out=<json file>]" << std::endl;
+}
+
+std::vector<int> parseIntList(const std::string& str)
+{
+	std::vector<int> values;
+
+	std::stringstream stream(str);
+	std::string item;
+	while (std::getline(stream, item, ','))
+	{
+		if (item.empty() == false)
+			values.push_back(std::atoi(item.c_str()));
+	}
+
+	return values;
+}
+
+std::vector<float> parseFloatList(const std::string& str)
+{
+	std::vector<float> values;
+
+	std::stringstream stream(str);
+	std::string item;
+	while (std::getline(stream, item, ','))
+	{
+		if (item.empty() == false)
+			values.push_back(float(std::atof(item.c_str())));
+	}
+
+	return values;
+}
+
+int initialize_params(int argc, char** argv, pc::utils::Parameters &params, RunMode& mode,
+	pc::bench::BenchmarkOptions& benchmarkOptions, pc::bench::CorpusOptions& corpusOptions, pc::bench::RegressionOptions& regressionOptions)
+{
+	pc::utils::CommandLine commandLine;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		char* argument = argv[i];
+		if (commandLine.Parse(argument))
+		{
+			continue;
+		}
+		else if (std::strcmp(argument, "-benchmark-stages") == 0)
+		{
+			mode = RunStageBenchmark;
+		}
+		else if (std::strcmp(argument, "-benchmark-throughput") == 0)
+		{
+			mode = RunThroughputBenchmark;
+		}
+		else if (std::strncmp(argument, "-benchmark-workers=", 19) == 0)
+		{
+			benchmarkOptions.workers = parseIntList(argument + 19);
+		}
+		else if (std::strcmp(argument, "-benchmark-warm-only") == 0)
+		{
+			benchmarkOptions.coldCache = false;
+		}
+		else if (std::strncmp(argument, "-benchmark-out=", 15) == 0)
+		{
+			benchmarkOptions.output = argument + 15;
+		}
+		else if (std::strncmp(argument, "-benchmark-filter=", 18) == 0)
+		{
+			benchmarkOptions.filter = argument + 18;
+		}
+		else if (std::strncmp(argument, "-benchmark-sizes=", 17) == 0)
+		{
+			benchmarkOptions.megapixels = parseIntList(argument + 17);
+		}
+		else if (std::strncmp(argument, "-benchmark-min-time=", 20) == 0)
+		{
+			benchmarkOptions.minTime = std::atof(argument + 20);
+		}
+		else if (std::strcmp(argument, "-generate-corpus") == 0)
+		{
+			mode = RunGenerateCorpus;
+		}
+		else if (std::strncmp(argument, "-corpus-sizes=", 14) == 0)
+		{
+			corpusOptions.megapixels = parseIntList(argument + 14);
+		}
+		else if (std::strncmp(argument, "-corpus-tilts=", 14) == 0)
+		{
+			corpusOptions.tilts = parseFloatList(argument + 14);
+		}
+		else if (std::strncmp(argument, "-corpus-orientations=", 21) == 0)
+		{
+			corpusOptions.orientations = parseIntList(argument + 21);
+		}
+		else if (std::strncmp(argument, "-corpus-backgrounds=", 20) == 0)
+		{
+			corpusOptions.backgrounds = parseIntList(argument + 20);
+		}
+		else if (std::strncmp(argument, "-regression-record=", 19) == 0)
+		{
+			mode = RunRegression;
+			regressionOptions.record = true;
+			regressionOptions.baseline = argument + 19;
+		}
+		else if (std::strncmp(argument, "-regression-compare=", 20) == 0)
+		{
+			mode = RunRegression;
+			regressionOptions.record = false;
+			regressionOptions.baseline = argument + 20;
+		}
+		else if (std::strncmp(argument, "-regression-tolerance=", 22) == 0)
+		{
+			regressionOptions.positionTolerance = float(std::atof(argument + 22));
+		}
+		else if (std::strncmp(argument, "-regression-angle-tolerance=", 28) == 0)
+		{
+			regressionOptions.angleTolerance = float(std::atof(argument + 28));
+		}
+		else if (std::strncmp(argument, "-h", 2) == 0)
+		{
+			return -1;
+		}
+		else
+		{
+			std::cout << "WARNING: unknown argument " << i << " (" << argument << ")" << std::endl;
+		}
+	}
+
+	if (mode == RunNone)
+		return -1;
+
+	commandLine.Apply(params);
+
+	if (mode == RunThroughputBenchmark || mode == RunRegression)
+		pc::utils::CreateOutputDirectories(params);
+
+	return 0;
+}
+
+int reportBenchmark(const pc::bench::TBenchmarkResults& results, const pc::bench::BenchmarkOptions& options)
+{
+	MSG_WRITE("");
+	pc::bench::PrintBenchmarkResults(results);
+
+	if (options.output.empty() == false && pc::bench::WriteBenchmarkReport(options.output, results) == false)
+	{
+		pc::Log::get().Write("cant write benchmark results to " + options.output, pc::LogLevel::Error);
+		return 1;
+	}
+
+	return 0;
+}
+
+int runStageBenchmark(const pc::utils::Parameters& params, const pc::bench::BenchmarkOptions& options)
+{
+	pc::bench::StageBenchmark benchmark(params, options);
+	return reportBenchmark(benchmark.Run(), options);
+}
+
+int runThroughputBenchmark(const pc::utils::Parameters& params, const pc::bench::BenchmarkOptions& options)
+{
+	pc::bench::ThroughputBenchmark benchmark(params, options);
+	return reportBenchmark(benchmark.Run(), options);
+}
+
+int generateCorpus(const pc::utils::Parameters& params, const pc::bench::CorpusOptions& options)
+{
+	pc::bench::CorpusGenerator generator(params, options);
+	return generator.Run() > 0 ? 0 : 1;
+}
+
+int runRegression(const pc::utils::Parameters& params, const pc::bench::BenchmarkOptions& benchmarkOptions,
+	const pc::bench::RegressionOptions& options)
+{
+	pc::bench::RegressionHarness harness(params, options);
+
+	pc::bench::TBenchmarkResults results;
+	int differences = harness.Run(results);
+
+	// in record mode there are results only if corpus has ground truth
+	int result = results.empty() ? 0 : reportBenchmark(results, benchmarkOptions);
+
+	MSG_WRITE("\n" + std::to_string(differences) + " images differ from baseline or ground truth");
+	return differences > 0 ? 1 : result;
+}
+
+int main(int argc, char* argv[])
+{
+try
+{
+	pc::utils::Parameters params;
+	pc::bench::BenchmarkOptions benchmarkOptions;
+	pc::bench::CorpusOptions corpusOptions;
+	pc::bench::RegressionOptions regressionOptions;
+	RunMode mode = RunNone;
+	if (initialize_params(argc, argv, params, mode, benchmarkOptions, corpusOptions, regressionOptions) < 0)
+	{
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	pc::utils::InitializeLog(params);
+
+	// NOTE pool must be configured before any worker is started
+	pc::utils::MatPool::get().Configure(size_t(max(0, params.matPoolMaxCachedMB)) * 1024u * 1024u, params.matPoolHugePages);
+
+	if (mode == RunStageBenchmark)
+		return runStageBenchmark(params, benchmarkOptions);
+
+	if (mode == RunThroughputBenchmark)
+		return runThroughputBenchmark(params, benchmarkOptions);
+
+	if (mode == RunGenerateCorpus)
+		return generateCorpus(params, corpusOptions);
+
+	return runRegression(params, benchmarkOptions, regressionOptions);
+}
+catch (const std::exception& ex)
+{
+	std::string msg = "\ncatch exception at main level\n  Message: " + std::string(ex.what()) + "\n";
+
+	std::cout << msg;
+	pc::Log::get().Write(msg, pc::LogLevel::Error);
+}
+
+return 1;
+}
@@ -0,0 +1,128 @@
+#include "benchmark.h"
+
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+#include <windows.h>
+
+#include "../utils/utils.h"
+#include "../utils/Log.h"
+
+namespace // anonymous
+{
+	double toMs(const FILETIME& kernel, const FILETIME& user)
+	{
+		ULARGE_INTEGER k, u;
+		k.LowPart = kernel.dwLowDateTime;
+		k.HighPart = kernel.dwHighDateTime;
+		u.LowPart = user.dwLowDateTime;
+		u.HighPart = user.dwHighDateTime;
+
+		// 100 ns units
+		return double(k.QuadPart + u.QuadPart) / 10000.0;
+	}
+} // namespace anonymous
+
+namespace pc
+{
+namespace bench
+{
+
+BenchmarkOptions::BenchmarkOptions()
+	: minTime(0.5)
+	, coldCache(true)
+{
+	const int sizes[] = { 2, 12, 24, 50 };
+	megapixels.assign(sizes, sizes + sizeof(sizes) / sizeof(sizes[0]));
+}
+
+BenchmarkResult::BenchmarkResult()
+	: iterations(0), realTime(0.0), cpuTime(0.0)
+{ }
+
+bool WriteBenchmarkReport(const std::string& filename, const TBenchmarkResults& results)
+{
+	std::ofstream file(filename, std::ios::out | std::ios::trunc);
+	if (!file)
+		return false;
+
+#ifdef _DEBUG
+	const char* buildType = "debug";
+#else
+	const char* buildType = "release";
+#endif
+
+	file << "{\n";
+	file << "  \"context\": {\n";
+	file << "    \"date\": " << utils::ToJsonString(utils::GetDate() + " " + utils::GetTime()) << ",\n";
+	file << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+	file << "    \"library_build_type\": \"" << buildType << "\"\n";
+	file << "  },\n";
+	file << "  \"benchmarks\": [";
+
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const BenchmarkResult& result = results[i];
+
+		file << (i == 0 ? "\n" : ",\n") << "    {\n";
+		file << "      \"name\": " << utils::ToJsonString(result.name) << ",\n";
+		file << "      \"run_name\": " << utils::ToJsonString(result.name) << ",\n";
+		file << "      \"run_type\": \"iteration\",\n";
+		file << "      \"iterations\": " << result.iterations << ",\n";
+		file << "      \"real_time\": " << result.realTime << ",\n";
+		file << "      \"cpu_time\": " << result.cpuTime << ",\n";
+
+		for (const auto& counter : result.counters)
+			file << "      " << utils::ToJsonString(counter.first) << ": " << counter.second << ",\n";
+
+		file << "      \"time_unit\": \"ms\"\n";
+		file << "    }";
+	}
+
+	file << "\n  ]\n}\n";
+
+	return bool(file);
+}
+
+void PrintBenchmarkResults(const TBenchmarkResults& results)
+{
+	char line[512];
+	sprintf_s(line, "%-32s %12s %12s %10s", "benchmark", "time (ms)", "cpu (ms)", "iterations");
+	MSG_WRITE(line);
+
+	for (const BenchmarkResult& result : results)
+	{
+		sprintf_s(line, "%-32s %12.3f %12.3f %10lld", result.name.c_str(), result.realTime, result.cpuTime, result.iterations);
+
+		std::string text = line;
+		for (const auto& counter : result.counters)
+		{
+			sprintf_s(line, " %s=%.6g", counter.first.c_str(), counter.second);
+			text += line;
+		}
+
+		MSG_WRITE(text);
+	}
+}
+
+double GetThreadCpuTime()
+{
+	FILETIME creation, exit, kernel, user;
+	if (GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user) == FALSE)
+		return 0.0;
+
+	return toMs(kernel, user);
+}
+
+double GetProcessCpuTime()
+{
+	FILETIME creation, exit, kernel, user;
+	if (GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user) == FALSE)
+		return 0.0;
+
+	return toMs(kernel, user);
+}
+
+}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace pc
+{
+namespace bench
+{
+
+// settings of benchmark modes (see command line arguments in benchMain.cpp)
+struct BenchmarkOptions
+{
+	std::string		 output;	 // json report, empty - results are only printed
+	std::string		 filter;	 // run only cases which names contain it
+	std::vector<int> megapixels; // sizes of synthetic images
+	double			 minTime;	 // min time of every case in seconds
+
+	std::vector<int> workers;	 // counts of workers for throughput, empty - 1, 2, 4... hardware threads
+	bool			 coldCache;	 // also run throughput with cold file cache
+
+	BenchmarkOptions();
+};
+
+// one measured case; times are per iteration in milliseconds
+struct BenchmarkResult
+{
+	std::string name;
+	long long	iterations;
+	double		realTime;
+	double		cpuTime;
+
+	// additional numbers (image size, percentiles, throughput...)
+	std::vector<std::pair<std::string, double>> counters;
+
+	BenchmarkResult();
+};
+
+typedef std::vector<BenchmarkResult> TBenchmarkResults;
+
+// report uses json format of Google Benchmark, so results of two commits
+// can be compared by its tools (compare.py)
+bool WriteBenchmarkReport(const std::string& filename, const TBenchmarkResults& results);
+
+void PrintBenchmarkResults(const TBenchmarkResults& results);
+
+// cpu time of calling thread or whole process in milliseconds
+double GetThreadCpuTime();
+double GetProcessCpuTime();
+
+}
+}
@@ -0,0 +1,275 @@
+#include "corpusGenerator.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+#include <exiv2/exiv2.hpp>
+
+#include <windows.h>
+
+#include "../utils/filesystem.h"
+#include "../utils/Log.h"
+
+namespace // anonymous
+{
+	const char* g_groundTruthFilename = "groundTruth.tsv";
+
+	const char* g_columns = "file\twidth\theight\torientation\ttilt\tbackground"
+		"\tfaceX\tfaceY\tfaceWidth\tfaceHeight\tleftEyeX\tleftEyeY\trightEyeX\trightEyeY"
+		"\tcropX\tcropY\tcropWidth\tcropHeight";
+
+	// pixels are stored so, that image is upright after transformation by orientation tag
+	cv::Mat toStored(const cv::Mat& upright, int orientation)
+	{
+		cv::Mat stored;
+
+		switch (orientation)
+		{
+		case 3:
+			cv::flip(upright, stored, -1);
+			break;
+		case 6: // displayed rotated by 90 clockwise
+			cv::transpose(upright, stored);
+			cv::flip(stored, stored, 0);
+			break;
+		case 8: // displayed rotated by 90 counterclockwise
+			cv::transpose(upright, stored);
+			cv::flip(stored, stored, 1);
+			break;
+		default:
+			stored = upright;
+			break;
+		}
+
+		return stored;
+	}
+
+	template<typename T>
+	std::vector<T> toVector(const T* values, size_t count)
+	{
+		return std::vector<T>(values, values + count);
+	}
+} // namespace anonymous
+
+namespace pc
+{
+namespace bench
+{
+
+CorpusOptions::CorpusOptions()
+	: quality(92)
+{
+	const int sizes[] = { 2, 12 };
+	const float angles[] = { -10.f, -4.f, 0.f, 4.f, 10.f };
+	const int tags[] = { 1, 3, 6, 8 };
+
+	// from far above threshold to near it, where silhouette is hard to separate from background
+	const int brightness[] = { 90, 50, 20 };
+
+	megapixels = toVector(sizes, sizeof(sizes) / sizeof(sizes[0]));
+	tilts = toVector(angles, sizeof(angles) / sizeof(angles[0]));
+	orientations = toVector(tags, sizeof(tags) / sizeof(tags[0]));
+	backgrounds = toVector(brightness, sizeof(brightness) / sizeof(brightness[0]));
+}
+
+CorpusGenerator::CorpusGenerator(const utils::Parameters& params, const CorpusOptions& options)
+	: m_params(params), m_options(options)
+{ }
+
+const char* CorpusGenerator::GetGroundTruthFilename()
+{
+	return g_groundTruthFilename;
+}
+
+size_t CorpusGenerator::Run()
+{
+	utils::filesystem::createDir(m_params.outputDirectory);
+
+	TCorpus corpus;
+	unsigned seed = 1u;
+
+	for (int megapixels : m_options.megapixels)
+	{
+		for (float tilt : m_options.tilts)
+		{
+			for (int orientation : m_options.orientations)
+			{
+				for (int background : m_options.backgrounds)
+				{
+					CorpusEntry entry = generate(megapixels, tilt, orientation, background, seed++);
+					if (entry.filename.empty() == false)
+						corpus.push_back(entry);
+				}
+			}
+		}
+	}
+
+	std::string groundTruth = m_params.outputDirectory + "/" + g_groundTruthFilename;
+	if (WriteGroundTruth(groundTruth, corpus) == false)
+		throw std::exception(("cant write ground truth to " + groundTruth).c_str());
+
+	MSG_WRITE(std::to_string(corpus.size()) + " images are written to " + m_params.outputDirectory);
+
+	return corpus.size();
+}
+
+CorpusEntry CorpusGenerator::generate(int megapixels, float tilt, int orientation, int background, unsigned seed)
+{
+	PortraitSpec spec(PortraitSize(megapixels));
+	spec.tilt = tilt;
+	spec.background = min(255, max(0, m_params.siholetteBrightnessThreshold + background));
+	spec.seed = seed;
+
+	SyntheticPortrait portrait = DrawSyntheticPortrait(spec);
+
+	char name[128];
+	sprintf_s(name, "portrait_%dmp_t%+.0f_o%d_b%+d.jpg", megapixels, tilt, orientation, background);
+
+	CorpusEntry entry;
+	entry.size = spec.size;
+	entry.orientation = orientation;
+	entry.tilt = tilt;
+	entry.background = background;
+	entry.face = portrait.face;
+	entry.eyes[0] = portrait.eyes[0];
+	entry.eyes[1] = portrait.eyes[1];
+	entry.crop = expectedCrop(portrait, spec);
+
+	if (writeImage(m_params.outputDirectory + "/" + name, portrait.image, orientation))
+		entry.filename = name;
+	else
+		pc::Log::get().Write(std::string("cant write synthetic image ") + name, pc::LogLevel::Error);
+
+	return entry;
+}
+
+cv::Rect CorpusGenerator::expectedCrop(const SyntheticPortrait& portrait, const PortraitSpec& spec) const
+{
+	// rotation stage turns whole image around its center, so head becomes upright
+	cv::Point2f center(spec.size.width * 0.5f, spec.size.height * 0.5f);
+	cv::Mat rotation = cv::getRotationMatrix2D(center, spec.tilt, 1.0);
+
+	const cv::Point2f& hair = portrait.hair.center;
+	cv::Point2f upright(
+		float(rotation.at<double>(0, 0) * hair.x + rotation.at<double>(0, 1) * hair.y + rotation.at<double>(0, 2)),
+		float(rotation.at<double>(1, 0) * hair.x + rotation.at<double>(1, 1) * hair.y + rotation.at<double>(1, 2)));
+
+	// hair is the only part of head which is darker than threshold
+	float halfWidth = portrait.hair.size.width * 0.5f;
+	float halfHeight = portrait.hair.size.height * 0.5f;
+
+	int stepx = int(float(spec.size.width) * m_params.cropRelativeScaleX);
+	int stepy = int(float(spec.size.height) * m_params.cropRelativeScaleY);
+
+	int minx = max(0, cvRound(upright.x - halfWidth) - stepx);
+	int maxx = min(spec.size.width, cvRound(upright.x + halfWidth) + stepx);
+	int miny = max(0, cvRound(upright.y - halfHeight) - stepy);
+
+	int width = maxx - minx;
+	int height = min(int(float(width) * m_params.aspectRatio), spec.size.height - miny);
+
+	return cv::Rect(minx, miny, width, height);
+}
+
+bool CorpusGenerator::writeImage(const std::string& filename, const cv::Mat& upright, int orientation) const
+{
+	std::vector<int> encodeParams;
+	encodeParams.push_back(cv::IMWRITE_JPEG_QUALITY);
+	encodeParams.push_back(m_options.quality);
+
+	std::vector<uchar> encoded;
+	if (cv::imencode(".jpg", toStored(upright, orientation), encoded, encodeParams) == false)
+		return false;
+
+	if (orientation != 1)
+	{
+		try
+		{
+			Exiv2::Image::AutoPtr image = Exiv2::ImageFactory::open(&encoded[0], long(encoded.size()));
+
+			image->exifData()["Exif.Image.Orientation"] = uint16_t(orientation);
+			image->writeMetadata();
+
+			Exiv2::BasicIo& io = image->io();
+			io.open();
+
+			Exiv2::DataBuf data = io.read(io.size());
+			io.close();
+
+			if (data.size_ <= 0)
+				return false;
+
+			encoded.assign(data.pData_, data.pData_ + data.size_);
+		}
+		catch (Exiv2::AnyError&)
+		{
+			return false;
+		}
+	}
+
+	std::ofstream file(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(&encoded[0]), std::streamsize(encoded.size()));
+
+	return bool(file);
+}
+
+bool CorpusGenerator::WriteGroundTruth(const std::string& filename, const TCorpus& corpus)
+{
+	std::ofstream file(filename, std::ios::out | std::ios::trunc);
+	if (!file)
+		return false;
+
+	file << g_columns << '\n';
+
+	for (const CorpusEntry& entry : corpus)
+	{
+		file << entry.filename << '\t' << entry.size.width << '\t' << entry.size.height
+			<< '\t' << entry.orientation << '\t' << entry.tilt << '\t' << entry.background
+			<< '\t' << entry.face.x << '\t' << entry.face.y << '\t' << entry.face.width << '\t' << entry.face.height
+			<< '\t' << entry.eyes[0].x << '\t' << entry.eyes[0].y << '\t' << entry.eyes[1].x << '\t' << entry.eyes[1].y
+			<< '\t' << entry.crop.x << '\t' << entry.crop.y << '\t' << entry.crop.width << '\t' << entry.crop.height << '\n';
+	}
+
+	return bool(file);
+}
+
+TCorpus CorpusGenerator::ReadGroundTruth(const std::string& filename)
+{
+	TCorpus corpus;
+
+	std::ifstream file(filename);
+	std::string line;
+
+	// skip header
+	if (!std::getline(file, line))
+		return corpus;
+
+	while (std::getline(file, line))
+	{
+		std::string::size_type tab = line.find('\t');
+		if (tab == std::string::npos)
+			continue;
+
+		CorpusEntry entry;
+		entry.filename = line.substr(0, tab);
+
+		std::istringstream stream(line.substr(tab + 1));
+		stream >> entry.size.width >> entry.size.height >> entry.orientation >> entry.tilt >> entry.background
+			>> entry.face.x >> entry.face.y >> entry.face.width >> entry.face.height
+			>> entry.eyes[0].x >> entry.eyes[0].y >> entry.eyes[1].x >> entry.eyes[1].y
+			>> entry.crop.x >> entry.crop.y >> entry.crop.width >> entry.crop.height;
+
+		if (stream)
+			corpus.push_back(entry);
+	}
+
+	return corpus;
+}
+
+}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "syntheticPortrait.h"
+#include "../utils/parameters.h"
+#include "../utils/classutils.h"
+
+namespace pc
+{
+namespace bench
+{
+
+// settings of synthetic corpus; every combination of values is generated
+struct CorpusOptions
+{
+	std::vector<int>   megapixels;
+	std::vector<float> tilts;		 // in degrees
+	std::vector<int>   orientations; // exif orientation tags: 1, 3, 6 or 8
+	std::vector<int>   backgrounds;	 // brightness relative to siholetteBrightnessThreshold
+	int				   quality;		 // of jpeg
+
+	CorpusOptions();
+};
+
+// ground truth of one generated image.
+// Coordinates are in upright image (as it's displayed with respect of orientation), full resolution
+struct CorpusEntry
+{
+	std::string filename;
+	cv::Size	size;
+	int			orientation;
+	float		tilt;
+	int			background;
+
+	cv::Rect	face;
+	cv::Point2f eyes[2];
+
+	// expected crop of image after rotation by tilt around its center, as contours stage computes it.
+	// It's approximate: only head silhouette is taken into account (no aspect ratio correction by chin)
+	cv::Rect	crop;
+};
+
+typedef std::vector<CorpusEntry> TCorpus;
+
+// writes deterministic synthetic portraits (jpeg) and groundTruth.tsv to output directory
+// of parameters, so benchmarks and accuracy tests don't need real photos.
+// RegressionHarness checks eyes and crop of corpus against its ground truth
+class CorpusGenerator : public utils::noncopyable
+{
+public:
+	CorpusGenerator(const utils::Parameters& params, const CorpusOptions& options);
+
+	// returns count of written images
+	size_t Run();
+
+	// name of ground truth file in corpus directory
+	static const char* GetGroundTruthFilename();
+
+	// empty corpus if file can't be read
+	static TCorpus ReadGroundTruth(const std::string& filename);
+	static bool	   WriteGroundTruth(const std::string& filename, const TCorpus& corpus);
+
+private:
+	CorpusEntry generate(int megapixels, float tilt, int orientation, int background, unsigned seed);
+
+	cv::Rect expectedCrop(const SyntheticPortrait& portrait, const PortraitSpec& spec) const;
+	bool	 writeImage(const std::string& filename, const cv::Mat& upright, int orientation) const;
+
+private:
+	utils::Parameters m_params;
+	CorpusOptions	  m_options;
+};
+
+}
+}
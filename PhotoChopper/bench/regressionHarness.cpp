@@ -0,0 +1,492 @@
+#include "regressionHarness.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#include <windows.h>
+
+#include "corpusGenerator.h"
+#include "../core/coreImpl.h"
+#include "../utils/filesystem.h"
+#include "../utils/utils.h"
+#include "../utils/Log.h"
+
+namespace // anonymous
+{
+	const char* g_columns = "file\tstatus\ttimeMs\tcpuMs\tfaceX\tfaceY\tfaceWidth\tfaceHeight"
+		"\tleftEyeX\tleftEyeY\trightEyeX\trightEyeY\tangle\tminx\tmaxx\tminy\tmaxy\treason";
+
+	std::vector<std::string> split(const std::string& line, char delimiter)
+	{
+		std::vector<std::string> items;
+
+		std::stringstream stream(line);
+		std::string item;
+		while (std::getline(stream, item, delimiter))
+			items.push_back(item);
+
+		return items;
+	}
+
+	// reason is the last column of baseline, so it mustn't break lines and columns
+	std::string sanitize(const std::string& str)
+	{
+		std::string result = str;
+		std::replace(result.begin(), result.end(), '\t', ' ');
+		std::replace(result.begin(), result.end(), '\n', ' ');
+		std::replace(result.begin(), result.end(), '\r', ' ');
+
+		return result;
+	}
+
+	double distance(const cv::Point2f& a, const cv::Point2f& b)
+	{
+		double dx = a.x - b.x, dy = a.y - b.y;
+		return std::sqrt(dx * dx + dy * dy);
+	}
+
+	std::string relativePath(const std::string& path, const std::string& directory)
+	{
+		if (directory.empty() == false && path.compare(0, directory.size(), directory) == 0 && path.size() > directory.size())
+			return path.substr(directory.size() + 1u);
+
+		return path;
+	}
+} // namespace anonymous
+
+namespace pc
+{
+namespace bench
+{
+
+RegressionOptions::RegressionOptions()
+	: record(false)
+	, positionTolerance(0.03f)
+	, angleTolerance(0.5f)
+{ }
+
+RegressionRecord::RegressionRecord()
+	: success(false), time(0.0), cpuTime(0.0), angle(0.f)
+	, minx(0), maxx(0), miny(0), maxy(0)
+{ }
+
+RegressionHarness::RegressionHarness(const utils::Parameters& params, const RegressionOptions& options)
+	: m_params(params)
+	, m_options(options)
+{
+	m_params.GUI = false;
+}
+
+int RegressionHarness::Run(TBenchmarkResults& results)
+{
+	TRegressionRecords baseline;
+	if (m_options.record == false)
+	{
+		baseline = ReadBaseline(m_options.baseline);
+		if (baseline.empty())
+			throw std::exception(("cant read regression baseline " + m_options.baseline).c_str());
+	}
+
+	TRegressionRecords current = runCorpus();
+	if (current.empty())
+	{
+		pc::Log::get().Write("regression corpus is empty: " + m_params.inputDirectory, pc::LogLevel::Error);
+		return 0;
+	}
+
+	int differences = 0;
+
+	if (m_options.record)
+	{
+		if (WriteBaseline(m_options.baseline, current) == false)
+			throw std::exception(("cant write regression baseline " + m_options.baseline).c_str());
+
+		MSG_WRITE("baseline of " + std::to_string(current.size()) + " images is written to " + m_options.baseline);
+	}
+	else
+	{
+		differences = compare(baseline, current, results);
+	}
+
+	// NOTE baseline only finds changes, results which were already wrong when it was recorded are found by ground truth
+	return differences + checkGroundTruth(current, results);
+}
+
+TRegressionRecords RegressionHarness::runCorpus()
+{
+	TRegressionRecords records;
+
+	utils::filesystem::TFiles files;
+	utils::filesystem::getFilesInDirectory(m_params.inputDirectory, files, m_params.extensionPattern, m_params.checkSubdirectories);
+
+	// NOTE files are processed in one thread, so times of images don't depend on each other
+	ProcessorImpl processor(m_params);
+
+	for (const utils::filesystem::FileEntry& file : files)
+	{
+		RegressionRecord record;
+		record.file = relativePath(file.GetPath(), m_params.inputDirectory);
+
+		MSG_WRITE(" :: " + std::to_string(records.size() + 1u) + "/" + std::to_string(files.size()) + " file: " + record.file + " :: ");
+
+		utils::Timer timer;
+		double cpuStart = GetThreadCpuTime();
+
+		try
+		{
+			processor.Open(file.GetPath());
+			processor.Process();
+
+			if (m_params.saveFiles)
+				processor.SaveAs(utils::filesystem::getOutputPath(file.GetPath(), m_params.inputDirectory, m_params.outputDirectory));
+
+			record.success = true;
+		}
+		catch (const std::exception& ex)
+		{
+			record.reason = sanitize(ex.what());
+		}
+
+		const utils::Box& box = processor.GetBox();
+		const std::vector<cv::Rect>& faces = processor.GetFaces();
+		const std::vector<cv::Rect>& eyes = processor.GetEyes();
+
+		// from resized image to full size one
+		float xScale = box.xScale > 0.f ? 1.f / box.xScale : 1.f;
+		float yScale = box.yScale > 0.f ? 1.f / box.yScale : 1.f;
+
+		if (faces.empty() == false)
+		{
+			const cv::Rect& face = faces[0];
+			record.face = cv::Rect(cvRound(face.x * xScale), cvRound(face.y * yScale), cvRound(face.width * xScale), cvRound(face.height * yScale));
+		}
+
+		if (eyes.size() >= 2u)
+		{
+			for (int i = 0; i < 2; ++i)
+			{
+				// left eye first
+				const cv::Rect& eye = eyes[(eyes[0].x <= eyes[1].x) ? i : 1 - i];
+				record.eyes[i] = cv::Point2f((eye.x + eye.width * 0.5f) * xScale, (eye.y + eye.height * 0.5f) * yScale);
+			}
+		}
+
+		record.angle = box.angle;
+		record.minx = cvRound(box.minx * xScale);
+		record.maxx = cvRound(box.maxx * xScale);
+		record.miny = cvRound(box.miny * yScale);
+		record.maxy = cvRound(box.maxy * yScale);
+
+		processor.Close();
+
+		record.time = timer.ElapsedMs();
+		record.cpuTime = GetThreadCpuTime() - cpuStart;
+
+		records.push_back(record);
+	}
+
+	return records;
+}
+
+double RegressionHarness::shift(const RegressionRecord& baseline, const RegressionRecord& current, std::string& what) const
+{
+	const cv::Point2f points[][2] = {
+		{ cv::Point2f(float(baseline.face.x), float(baseline.face.y)), cv::Point2f(float(current.face.x), float(current.face.y)) },
+		{ cv::Point2f(float(baseline.face.br().x), float(baseline.face.br().y)), cv::Point2f(float(current.face.br().x), float(current.face.br().y)) },
+		{ baseline.eyes[0], current.eyes[0] },
+		{ baseline.eyes[1], current.eyes[1] }
+	};
+
+	const char* names[] = { "face", "face", "left eye", "right eye" };
+
+	double result = 0.0;
+	for (int i = 0; i < 4; ++i)
+	{
+		double d = distance(points[i][0], points[i][1]);
+		if (d > result)
+		{
+			result = d;
+			what = names[i];
+		}
+	}
+
+	const int borders[][2] = {
+		{ baseline.minx, current.minx },
+		{ baseline.maxx, current.maxx },
+		{ baseline.miny, current.miny },
+		{ baseline.maxy, current.maxy }
+	};
+
+	for (int i = 0; i < 4; ++i)
+	{
+		double d = std::abs(borders[i][0] - borders[i][1]);
+		if (d > result)
+		{
+			result = d;
+			what = "crop";
+		}
+	}
+
+	return result;
+}
+
+int RegressionHarness::compare(const TRegressionRecords& baseline, const TRegressionRecords& current, TBenchmarkResults& results)
+{
+	std::map<std::string, const RegressionRecord*> baselineFiles;
+	for (const RegressionRecord& record : baseline)
+		baselineFiles[record.file] = &record;
+
+	int matched = 0, moved = 0, regressed = 0, fixed = 0, missing = 0;
+	int baselineFails = 0, currentFails = 0;
+
+	double baselineTime = 0.0, currentTime = 0.0;
+	double baselineCpu = 0.0, currentCpu = 0.0;
+	double eyeShift = 0.0, maxShift = 0.0, maxAngleDelta = 0.0;
+	int comparedCount = 0, shiftsCount = 0;
+
+	for (const RegressionRecord& record : current)
+	{
+		auto it = baselineFiles.find(record.file);
+		if (it == baselineFiles.end())
+		{
+			++missing;
+			continue;
+		}
+
+		const RegressionRecord& base = *it->second;
+		++comparedCount;
+
+		// speed is compared only by the same files
+		baselineTime += base.time;
+		currentTime += record.time;
+		baselineCpu += base.cpuTime;
+		currentCpu += record.cpuTime;
+
+		baselineFails += base.success ? 0 : 1;
+		currentFails += record.success ? 0 : 1;
+
+		if (base.success && record.success == false)
+		{
+			++regressed;
+			pc::Log::get().Write("regression: " + record.file + " fails now (" + record.reason + ")", pc::LogLevel::Warning);
+		}
+		else if (base.success == false && record.success)
+		{
+			++fixed;
+			LOG_WRITE("regression: " + record.file + " doesn't fail now (was: " + base.reason + ")", pc::LogLevel::Note);
+		}
+		else if (base.success == false)
+		{
+			++matched;
+		}
+		else
+		{
+			std::string what;
+			double pixels = shift(base, record, what);
+			double angleDelta = std::abs(record.angle - base.angle);
+
+			eyeShift += (distance(base.eyes[0], record.eyes[0]) + distance(base.eyes[1], record.eyes[1])) * 0.5;
+			maxShift = max(maxShift, pixels);
+			maxAngleDelta = max(maxAngleDelta, angleDelta);
+			++shiftsCount;
+
+			double tolerance = m_options.positionTolerance * max(1, base.face.width);
+			if (pixels > tolerance || angleDelta > m_options.angleTolerance)
+			{
+				++moved;
+
+				char line[512];
+				sprintf_s(line, "regression: %s is moved: %s by %.1f px (tolerance %.1f), angle by %.2f deg",
+					record.file.c_str(), what.c_str(), pixels, tolerance, angleDelta);
+				pc::Log::get().Write(line, pc::LogLevel::Warning);
+			}
+			else
+			{
+				++matched;
+			}
+		}
+	}
+
+	if (missing > 0)
+		pc::Log::get().Write(std::to_string(missing) + " images aren't found in baseline, they are skipped", pc::LogLevel::Warning);
+
+	if (comparedCount == 0)
+		return 0;
+
+	BenchmarkResult baseResult;
+	baseResult.name = "regression/baseline";
+	baseResult.iterations = comparedCount;
+	baseResult.realTime = baselineTime / comparedCount;
+	baseResult.cpuTime = baselineCpu / comparedCount;
+	baseResult.counters.push_back(std::make_pair("failed", double(baselineFails)));
+	results.push_back(baseResult);
+
+	BenchmarkResult result;
+	result.name = "regression/current";
+	result.iterations = comparedCount;
+	result.realTime = currentTime / comparedCount;
+	result.cpuTime = currentCpu / comparedCount;
+	result.counters.push_back(std::make_pair("failed", double(currentFails)));
+	result.counters.push_back(std::make_pair("speedup", currentTime > 0.0 ? baselineTime / currentTime : 0.0));
+	result.counters.push_back(std::make_pair("matched", double(matched)));
+	result.counters.push_back(std::make_pair("moved", double(moved)));
+	result.counters.push_back(std::make_pair("regressed", double(regressed)));
+	result.counters.push_back(std::make_pair("fixed", double(fixed)));
+	result.counters.push_back(std::make_pair("meanEyeShift", shiftsCount > 0 ? eyeShift / shiftsCount : 0.0));
+	result.counters.push_back(std::make_pair("maxShift", maxShift));
+	result.counters.push_back(std::make_pair("maxAngleDelta", maxAngleDelta));
+	results.push_back(result);
+
+	return moved + regressed;
+}
+
+int RegressionHarness::checkGroundTruth(const TRegressionRecords& current, TBenchmarkResults& results) const
+{
+	std::string filename = m_params.inputDirectory + "/" + CorpusGenerator::GetGroundTruthFilename();
+	if (utils::filesystem::fileExists(filename) == false)
+		return 0;
+
+	TCorpus corpus = CorpusGenerator::ReadGroundTruth(filename);
+
+	std::map<std::string, const CorpusEntry*> entries;
+	for (const CorpusEntry& entry : corpus)
+		entries[entry.filename] = &entry;
+
+	int checkedCount = 0, wrong = 0, fails = 0;
+	double time = 0.0, cpu = 0.0;
+	double eyeError = 0.0, maxEyeError = 0.0, maxCropError = 0.0;
+
+	for (const RegressionRecord& record : current)
+	{
+		auto it = entries.find(record.file);
+		if (it == entries.end())
+			continue;
+
+		const CorpusEntry& entry = *it->second;
+		++checkedCount;
+
+		time += record.time;
+		cpu += record.cpuTime;
+
+		// fails are already reported by comparison with baseline
+		if (record.success == false)
+		{
+			++fails;
+			continue;
+		}
+
+		// left eye first, as in records
+		int left = entry.eyes[0].x <= entry.eyes[1].x ? 0 : 1;
+		double leftError = distance(entry.eyes[left], record.eyes[0]);
+		double rightError = distance(entry.eyes[1 - left], record.eyes[1]);
+
+		// NOTE bottom of crop isn't compared, ground truth doesn't know correction of it by chin
+		const int borders[][2] = {
+			{ entry.crop.x, record.minx },
+			{ entry.crop.x + entry.crop.width, record.maxx },
+			{ entry.crop.y, record.miny }
+		};
+
+		double cropError = 0.0;
+		for (int i = 0; i < 3; ++i)
+			cropError = max(cropError, double(std::abs(borders[i][0] - borders[i][1])));
+
+		double eyesError = max(leftError, rightError);
+
+		eyeError += (leftError + rightError) * 0.5;
+		maxEyeError = max(maxEyeError, eyesError);
+		maxCropError = max(maxCropError, cropError);
+
+		double tolerance = m_options.positionTolerance * max(1, entry.face.width);
+		if (eyesError > tolerance || cropError > tolerance)
+		{
+			++wrong;
+
+			char line[512];
+			sprintf_s(line, "ground truth: %s is wrong: eyes by %.1f px, crop by %.1f px (tolerance %.1f)",
+				record.file.c_str(), eyesError, cropError, tolerance);
+			pc::Log::get().Write(line, pc::LogLevel::Warning);
+		}
+	}
+
+	if (checkedCount == 0)
+		return 0;
+
+	int succeeded = checkedCount - fails;
+
+	BenchmarkResult result;
+	result.name = "regression/groundTruth";
+	result.iterations = checkedCount;
+	result.realTime = time / checkedCount;
+	result.cpuTime = cpu / checkedCount;
+	result.counters.push_back(std::make_pair("failed", double(fails)));
+	result.counters.push_back(std::make_pair("wrong", double(wrong)));
+	result.counters.push_back(std::make_pair("meanEyeError", succeeded > 0 ? eyeError / succeeded : 0.0));
+	result.counters.push_back(std::make_pair("maxEyeError", maxEyeError));
+	result.counters.push_back(std::make_pair("maxCropError", maxCropError));
+	results.push_back(result);
+
+	return wrong;
+}
+
+bool RegressionHarness::WriteBaseline(const std::string& filename, const TRegressionRecords& records)
+{
+	std::ofstream file(filename, std::ios::out | std::ios::trunc);
+	if (!file)
+		return false;
+
+	file << g_columns << '\n';
+
+	for (const RegressionRecord& record : records)
+	{
+		file << record.file << '\t' << (record.success ? "ok" : "fail") << '\t' << record.time << '\t' << record.cpuTime
+			<< '\t' << record.face.x << '\t' << record.face.y << '\t' << record.face.width << '\t' << record.face.height
+			<< '\t' << record.eyes[0].x << '\t' << record.eyes[0].y << '\t' << record.eyes[1].x << '\t' << record.eyes[1].y
+			<< '\t' << record.angle << '\t' << record.minx << '\t' << record.maxx << '\t' << record.miny << '\t' << record.maxy
+			<< '\t' << record.reason << '\n';
+	}
+
+	return bool(file);
+}
+
+TRegressionRecords RegressionHarness::ReadBaseline(const std::string& filename)
+{
+	TRegressionRecords records;
+
+	std::ifstream file(filename);
+	std::string line;
+
+	// skip header
+	if (!std::getline(file, line))
+		return records;
+
+	while (std::getline(file, line))
+	{
+		std::vector<std::string> items = split(line, '\t');
+		if (items.size() < 17u)
+			continue;
+
+		RegressionRecord record;
+		record.file = items[0];
+		record.success = items[1] == "ok";
+		record.reason = items.size() > 17u ? items[17] : std::string();
+
+		std::istringstream stream(line.substr(items[0].size() + items[1].size() + 2u));
+		stream >> record.time >> record.cpuTime
+			>> record.face.x >> record.face.y >> record.face.width >> record.face.height
+			>> record.eyes[0].x >> record.eyes[0].y >> record.eyes[1].x >> record.eyes[1].y
+			>> record.angle >> record.minx >> record.maxx >> record.miny >> record.maxy;
+
+		if (stream)
+			records.push_back(record);
+	}
+
+	return records;
+}
+
+}
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "benchmark.h"
+#include "../utils/parameters.h"
+#include "../utils/classutils.h"
+
+namespace pc
+{
+namespace bench
+{
+
+// settings of regression mode (see command line arguments in benchMain.cpp)
+struct RegressionOptions
+{
+	std::string baseline;		   // tsv file with results of baseline run
+	bool		record;			   // write baseline instead of comparison with it
+
+	float		positionTolerance; // max shift of face, eyes and crop relative to face width
+	float		angleTolerance;	   // max difference of rotation angle in degrees
+
+	RegressionOptions();
+};
+
+// outputs of processing of one image.
+// Coordinates are in full size prepared image, so they don't depend on resize and decode scale
+struct RegressionRecord
+{
+	std::string file; // relative to input directory
+	bool		success;
+	std::string reason; // of fail
+	double		time;	 // ms
+	double		cpuTime; // ms
+
+	cv::Rect	face;
+	cv::Point2f eyes[2];
+	float		angle;
+
+	int minx;
+	int maxx;
+	int miny;
+	int maxy;
+
+	RegressionRecord();
+};
+
+typedef std::vector<RegressionRecord> TRegressionRecords;
+
+// runs corpus of input directory, records outputs of every image to baseline file
+// or compares them with baseline; reports speed and accuracy of both runs side by side.
+// Corpus made by CorpusGenerator is also checked against its ground truth
+class RegressionHarness : public utils::noncopyable
+{
+public:
+	RegressionHarness(const utils::Parameters& params, const RegressionOptions& options);
+
+	// returns count of images which results differ from baseline (moved or failed) or from ground truth
+	int Run(TBenchmarkResults& results);
+
+	static TRegressionRecords ReadBaseline(const std::string& filename);
+	static bool				  WriteBaseline(const std::string& filename, const TRegressionRecords& records);
+
+private:
+	TRegressionRecords runCorpus();
+	int compare(const TRegressionRecords& baseline, const TRegressionRecords& current, TBenchmarkResults& results);
+
+	// errors of eyes and crop relative to ground truth of corpus, 0 if corpus has no ground truth
+	int checkGroundTruth(const TRegressionRecords& current, TBenchmarkResults& results) const;
+
+	// max shift of face corners, eyes and crop borders in pixels
+	double shift(const RegressionRecord& baseline, const RegressionRecord& current, std::string& what) const;
+
+private:
+	utils::Parameters m_params;
+	RegressionOptions m_options;
+};
+
+}
+}
@@ -0,0 +1,239 @@
+#include "stageBenchmark.h"
+
+#include <algorithm>
+
+#include <opencv2/imgproc.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+#include "../core/coreImpl.h"
+#include "../utils/latencyHistogram.h"
+#include "../utils/utils.h"
+#include "../utils/Log.h"
+
+namespace // anonymous
+{
+	const long long g_minIterations = 3;
+	const long long g_maxIterations = 100000;
+
+	// tilt of eyes line for rotation benchmarks
+	const float g_angle = 3.f;
+
+	cv::Rect scaleRect(const cv::Rect& rect, float xScale, float yScale)
+	{
+		return cv::Rect(cvRound(rect.x * xScale), cvRound(rect.y * yScale), cvRound(rect.width * xScale), cvRound(rect.height * yScale));
+	}
+} // namespace anonymous
+
+namespace pc
+{
+namespace bench
+{
+
+StageBenchmark::StageBenchmark(const utils::Parameters& params, const BenchmarkOptions& options)
+	: m_params(params)
+	, m_options(options)
+{
+	// windows and debug images aren't needed
+	m_params.GUI = false;
+	m_params.saveFiles = false;
+
+	// lossless path is opt-in, but its case must measure transformation (state 'withFile' has no tilt)
+	m_params.losslessJpeg = true;
+}
+
+TBenchmarkResults StageBenchmark::Run()
+{
+	m_results.clear();
+
+	// NOTE stages are measured in one thread, so cpu time is comparable with real one
+	int openCVThreads = cv::getNumThreads();
+	cv::setNumThreads(1);
+
+	for (int megapixels : m_options.megapixels)
+		runSize(megapixels);
+
+	cv::setNumThreads(openCVThreads);
+
+	return m_results;
+}
+
+void StageBenchmark::prepareFixture(Fixture& fixture, int megapixels, ProcessorImpl& processor)
+{
+	cv::Size size = PortraitSize(megapixels);
+
+	fixture.sizeName = std::to_string(megapixels) + "MP";
+	fixture.portrait = DrawSyntheticPortrait(PortraitSpec(size));
+
+	std::vector<int> quality;
+	quality.push_back(cv::IMWRITE_JPEG_QUALITY);
+	quality.push_back(95);
+	cv::imencode(".jpg", fixture.portrait.image, fixture.jpeg, quality);
+
+	float xScale = processor.m_box.xScale;
+	float yScale = processor.m_box.yScale;
+
+	cv::resize(fixture.portrait.image, fixture.resized, cv::Size(), xScale, yScale, cv::INTER_LINEAR);
+
+	fixture.face = scaleRect(fixture.portrait.face, xScale, yScale);
+
+	fixture.eyeCenters.clear();
+	for (int i = 0; i < 2; ++i)
+	{
+		fixture.eyes[i] = scaleRect(fixture.portrait.eyeRects[i], xScale, yScale);
+		fixture.eyeCenters.push_back(cv::Point2f(fixture.portrait.eyes[i].x * xScale, fixture.portrait.eyes[i].y * yScale));
+	}
+
+	// tilt right eye, so there is something to rotate
+	fixture.eyeCenters[1].y += std::tan(g_angle * float(CV_PI) / 180.f) * (fixture.eyeCenters[1].x - fixture.eyeCenters[0].x);
+}
+
+void StageBenchmark::setWorkingState(ProcessorImpl& processor, const Fixture& fixture, float angle)
+{
+	processor.reset();
+
+	processor.m_isOpen = true;
+	processor.m_filename = "synthetic_" + fixture.sizeName;
+
+	// NOTE images which are changed by stages are copied, origin image is only replaced
+	processor.m_originImage = fixture.portrait.image;
+	processor.m_originSize = fixture.portrait.image.size();
+	processor.m_preparedSize = processor.m_originSize;
+
+	processor.m_resizedImage = fixture.resized.clone();
+	processor.m_planes.Reset(processor.m_resizedImage);
+	processor.m_planes.Gray();
+	processor.m_resultOverlay.Reset(processor.m_resizedImage);
+	processor.m_originOverlay.Reset(processor.m_resizedImage);
+
+	processor.m_faces.assign(1, fixture.face);
+	processor.m_eyes.assign(fixture.eyes, fixture.eyes + 2);
+
+	// crop box around face like contours makes it
+	utils::Box& box = processor.m_box;
+	box.angle = angle;
+	box.minx = std::max(0, fixture.face.x - fixture.face.width / 3);
+	box.maxx = std::min(fixture.resized.cols, fixture.face.x + fixture.face.width * 4 / 3);
+	box.miny = std::max(0, fixture.face.y - fixture.face.height / 3);
+	box.maxy = std::min(fixture.resized.rows, box.miny + int(float(box.width()) * m_params.aspectRatio));
+}
+
+template <typename Setup, typename Func>
+void StageBenchmark::measure(const std::string& name, const Fixture& fixture, Setup setup, Func func)
+{
+	std::string fullName = name + "/" + fixture.sizeName;
+	if (m_options.filter.empty() == false && fullName.find(m_options.filter) == std::string::npos)
+		return;
+
+	// warm up caches and lazy initialization
+	setup();
+	func();
+
+	utils::LatencyHistogram times;
+
+	double total = 0.0;
+	double cpu = 0.0;
+	long long iterations = 0;
+
+	// NOTE cpu time has resolution of scheduler quantum, so it's precise only for long runs
+	while ((total < m_options.minTime * 1000.0 || iterations < g_minIterations) && iterations < g_maxIterations)
+	{
+		setup();
+
+		double cpuStart = GetThreadCpuTime();
+		utils::Timer timer;
+
+		func();
+
+		double elapsed = timer.ElapsedMs();
+		cpu += GetThreadCpuTime() - cpuStart;
+
+		times.Record(elapsed);
+		total += elapsed;
+		++iterations;
+	}
+
+	BenchmarkResult result;
+	result.name = fullName;
+	result.iterations = iterations;
+	result.realTime = total / double(iterations);
+	result.cpuTime = cpu / double(iterations);
+
+	result.counters.push_back(std::make_pair("width", double(fixture.portrait.image.cols)));
+	result.counters.push_back(std::make_pair("height", double(fixture.portrait.image.rows)));
+	result.counters.push_back(std::make_pair("p50", times.GetPercentile(50.0)));
+	result.counters.push_back(std::make_pair("p95", times.GetPercentile(95.0)));
+	result.counters.push_back(std::make_pair("max", times.GetMax()));
+
+	MSG_WRITE(fullName + ": " + std::to_string(result.realTime) + " ms");
+
+	m_results.push_back(result);
+}
+
+void StageBenchmark::runSize(int megapixels)
+{
+	ProcessorImpl processor(m_params);
+
+	Fixture fixture;
+	prepareFixture(fixture, megapixels, processor);
+
+	const Fixture& f = fixture;
+	ProcessorImpl& p = processor;
+
+	auto noSetup = []() {};
+	auto working = [&]() { setWorkingState(p, f, 0.f); };
+	auto rotated = [&]() { setWorkingState(p, f, g_angle); };
+	auto withFile = [&]() { setWorkingState(p, f, 0.f); p.m_fileData = f.jpeg; };
+
+	cv::Mat image;
+	cv::Size originSize;
+	std::vector<unsigned char> encoded;
+	int lipsY = 0;
+
+	// full size image
+	measure("decode", f, withFile, [&]() { p.decodeJpeg(image, 1.f, nullptr); });
+	measure("decodeReduced", f, withFile, [&]() { p.decodeJpeg(image, p.m_box.xScale, &originSize); });
+
+	measure("resize", f, noSetup, [&]() {
+		cv::resize(f.portrait.image, image, cv::Size(), p.m_box.xScale, p.m_box.yScale, cv::INTER_LINEAR);
+	});
+
+	// working image
+	measure("grayscale", f, noSetup, [&]() { cv::cvtColor(f.resized, image, cv::COLOR_RGB2GRAY); });
+	measure("hsv", f, noSetup, [&]() { cv::cvtColor(f.resized, image, cv::COLOR_BGR2HSV); });
+
+	measure("faceDetection", f, working, [&]() {
+		// same parameters as in processImpl
+		p.m_cascadeFrontalFace->detectMultiScale(p.m_planes.Gray(), p.m_faces, 1.3, 5, 0, cv::Size(80, 80));
+	});
+
+	measure("eyesDetection", f, working, [&]() { p.detectEyes(); });
+	measure("lips", f, working, [&]() { lipsY = p.findLips(); });
+	measure("faceBottom", f, [&]() { working(); lipsY = p.findLips(); }, [&]() { p.findFaceBottom(p.m_planes.Gray(), lipsY); });
+
+	measure("contours", f, working, [&]() {
+		int faceBottomY = f.face.y + f.face.height;
+		p.contours(faceBottomY);
+	});
+
+	measure("rotation", f, working, [&]() {
+		std::vector<cv::Point2f> eyeCenters = f.eyeCenters;
+		p.rotate(eyeCenters);
+	});
+
+	// full size result
+	measure("crop", f, working, [&]() { p.processOriginalImage(); });
+	measure("transform", f, rotated, [&]() { p.processOriginalImage(); });
+
+	// NOTE transformJpegLossless silently returns false when it can't be used, so the case isn't measured then
+	withFile();
+	if (p.transformJpegLossless())
+		measure("losslessTransform", f, withFile, [&]() { p.transformJpegLossless(); });
+	else
+		pc::Log::get().Write("losslessTransform/" + f.sizeName + " is skipped, synthetic image can't be transformed losslessly", pc::LogLevel::Error);
+
+	auto cropped = [&]() { setWorkingState(p, f, 0.f); p.processOriginalImage(); };
+	measure("encode", f, cropped, [&]() { cv::imencode(".jpg", p.m_originImage, encoded); });
+}
+
+}
+}
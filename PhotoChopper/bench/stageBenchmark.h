@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+
+#include <opencv2/core.hpp>
+
+#include "benchmark.h"
+#include "syntheticPortrait.h"
+#include "../utils/parameters.h"
+#include "../utils/classutils.h"
+
+namespace pc
+{
+
+class ProcessorImpl;
+
+namespace bench
+{
+
+// measures every stage of ProcessorImpl in isolation on synthetic portraits of several sizes.
+// Processor state which stage needs is set directly, so stages don't depend on results of detection
+class StageBenchmark : public utils::noncopyable
+{
+public:
+	StageBenchmark(const utils::Parameters& params, const BenchmarkOptions& options);
+
+	TBenchmarkResults Run();
+
+private:
+	struct Fixture
+	{
+		std::string		  sizeName;
+		SyntheticPortrait portrait;
+		std::vector<unsigned char> jpeg;
+
+		// in coordinates of working (resized) image
+		cv::Mat  resized;
+		cv::Rect face;
+		cv::Rect eyes[2];
+		std::vector<cv::Point2f> eyeCenters;
+	};
+
+	void runSize(int megapixels);
+	void prepareFixture(Fixture& fixture, int megapixels, ProcessorImpl& processor);
+
+	// state of processor after detection of given fixture
+	void setWorkingState(ProcessorImpl& processor, const Fixture& fixture, float angle);
+
+	template <typename Setup, typename Func>
+	void measure(const std::string& name, const Fixture& fixture, Setup setup, Func func);
+
+private:
+	utils::Parameters m_params;
+	BenchmarkOptions  m_options;
+	TBenchmarkResults m_results;
+};
+
+}
+}
@@ -0,0 +1,141 @@
+#include "syntheticPortrait.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <opencv2/imgproc.hpp>
+
+namespace // anonymous
+{
+	const cv::Scalar g_skinColor(150, 175, 220);
+	const cv::Scalar g_hairColor(40, 35, 30);
+	const cv::Scalar g_clothesColor(70, 55, 45);
+	const cv::Scalar g_lipsColor(95, 85, 190);
+
+	// parts of head are set relative to image size and rotated with head around face center
+	class HeadLayout
+	{
+	public:
+		HeadLayout(const cv::Size& size, double faceX, double faceY, float tilt)
+			: m_size(size)
+			, m_center(float(size.width * faceX), float(size.height * faceY))
+			, m_tilt(tilt)
+			, m_rotation(cv::getRotationMatrix2D(m_center, -tilt, 1.0))
+		{ }
+
+		cv::Point2f Point(double dx, double dy) const
+		{
+			cv::Point2f p(m_center.x + float(m_size.width * dx), m_center.y + float(m_size.height * dy));
+			return cv::Point2f(
+				float(m_rotation.at<double>(0, 0) * p.x + m_rotation.at<double>(0, 1) * p.y + m_rotation.at<double>(0, 2)),
+				float(m_rotation.at<double>(1, 0) * p.x + m_rotation.at<double>(1, 1) * p.y + m_rotation.at<double>(1, 2)));
+		}
+
+		cv::Size Axes(double x, double y) const
+		{
+			return cv::Size(std::max(1, cvRound(m_size.width * x)), std::max(1, cvRound(m_size.height * y)));
+		}
+
+		cv::RotatedRect Ellipse(double dx, double dy, double axisX, double axisY) const
+		{
+			cv::Size axes = Axes(axisX, axisY);
+			return cv::RotatedRect(Point(dx, dy), cv::Size2f(2.f * axes.width, 2.f * axes.height), m_tilt);
+		}
+
+	private:
+		cv::Size	m_size;
+		cv::Point2f m_center;
+		float		m_tilt;
+		cv::Mat		m_rotation;
+	};
+
+	cv::Point toPoint(const cv::Size& size, double x, double y)
+	{
+		return cv::Point(cvRound(size.width * x), cvRound(size.height * y));
+	}
+} // namespace anonymous
+
+namespace pc
+{
+namespace bench
+{
+
+PortraitSpec::PortraitSpec(const cv::Size& imageSize /*= cv::Size(1224, 1632)*/)
+	: size(imageSize)
+	, tilt(0.f)
+	, background(232)
+	, seed(1u)
+{ }
+
+cv::Size PortraitSize(int megapixels)
+{
+	int width = int(std::sqrt(megapixels * 1000000.0 * 3.0 / 4.0) / 16.0 + 0.5) * 16;
+	int height = (width * 4 / 3 + 8) / 16 * 16;
+
+	return cv::Size(width, height);
+}
+
+SyntheticPortrait DrawSyntheticPortrait(const PortraitSpec& spec)
+{
+	const cv::Size& size = spec.size;
+
+	SyntheticPortrait portrait;
+	portrait.image.create(size, CV_8UC3);
+
+	// background is a bit darker to the bottom
+	for (int y = 0; y < size.height; ++y)
+	{
+		double brightness = spec.background + 8.0 - 16.0 * y / size.height;
+		portrait.image.row(y).setTo(cv::Scalar(brightness, brightness, brightness));
+	}
+
+	cv::Mat& image = portrait.image;
+	const double faceX = 0.5, faceY = 0.4;
+
+	// shoulders and neck don't move with head
+	cv::ellipse(image, toPoint(size, faceX, 1.02), cv::Size(cvRound(size.width * 0.42), cvRound(size.height * 0.22)),
+		0.0, 0.0, 360.0, g_clothesColor, cv::FILLED, cv::LINE_AA);
+	cv::rectangle(image, toPoint(size, faceX - 0.07, faceY + 0.1), toPoint(size, faceX + 0.07, faceY + 0.27), g_skinColor, cv::FILLED);
+
+	HeadLayout head(size, faceX, faceY, spec.tilt);
+
+	// hair is covered by face except top and sides
+	portrait.hair = head.Ellipse(0.0, -0.05, 0.19, 0.14);
+	cv::ellipse(image, portrait.hair, g_hairColor, cv::FILLED, cv::LINE_AA);
+
+	cv::RotatedRect face = head.Ellipse(0.0, 0.0, 0.17, 0.16);
+	cv::ellipse(image, face, g_skinColor, cv::FILLED, cv::LINE_AA);
+	portrait.face = face.boundingRect();
+
+	for (int i = 0; i < 2; ++i)
+	{
+		double dx = (i == 0 ? -0.065 : 0.065);
+		cv::Size axes = head.Axes(0.03, 0.012);
+
+		cv::RotatedRect eye = head.Ellipse(dx, -0.03, 0.03, 0.012);
+		cv::ellipse(image, eye, cv::Scalar(245, 245, 245), cv::FILLED, cv::LINE_AA);
+		cv::circle(image, eye.center, std::max(1, axes.height), cv::Scalar(30, 30, 30), cv::FILLED, cv::LINE_AA);
+
+		// eyebrow
+		cv::Point2f brow = head.Point(dx, -0.03 - 2.0 * axes.height / size.height);
+		cv::ellipse(image, brow, axes, spec.tilt, 200.0, 340.0, g_hairColor, std::max(1, axes.height / 2), cv::LINE_AA);
+
+		portrait.eyes[i] = eye.center;
+		portrait.eyeRects[i] = eye.boundingRect();
+	}
+
+	cv::ellipse(image, head.Ellipse(0.0, 0.09, 0.05, 0.012), g_lipsColor, cv::FILLED, cv::LINE_AA);
+
+	// sensor noise, so encoders and detectors don't work on flat areas
+	cv::RNG rng(spec.seed);
+	cv::Mat noise(size, CV_8UC3);
+	rng.fill(noise, cv::RNG::UNIFORM, 0, 12);
+
+	cv::add(image, noise, image);
+	cv::subtract(image, cv::Scalar::all(6), image);
+
+	return portrait;
+}
+
+}
+}
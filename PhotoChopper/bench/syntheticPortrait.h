@@ -0,0 +1,41 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+
+namespace pc
+{
+namespace bench
+{
+
+// parameters of synthetic portrait
+struct PortraitSpec
+{
+	cv::Size size;
+	float	 tilt;		 // rotation of head around face center in degrees, positive - right eye is lower
+	int		 background; // brightness of background
+	unsigned seed;		 // of noise
+
+	explicit PortraitSpec(const cv::Size& size = cv::Size(1224, 1632));
+};
+
+// simple drawn portrait (face, hair, eyes, lips, shoulders on background)
+// with known positions of its parts, so benchmarks and tests don't need real photos
+struct SyntheticPortrait
+{
+	cv::Mat		image;
+	cv::Rect	face;
+	cv::Point2f eyes[2]; // left, right
+	cv::Rect	eyeRects[2];
+
+	// hair is the darkest part of head, so it defines silhouette of head
+	cv::RotatedRect hair;
+};
+
+// portrait 3:4, sides are multiple of 16 (jpeg MCU)
+cv::Size PortraitSize(int megapixels);
+
+// NOTE result depends only on spec
+SyntheticPortrait DrawSyntheticPortrait(const PortraitSpec& spec);
+
+}
+}
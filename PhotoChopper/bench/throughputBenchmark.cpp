@@ -0,0 +1,218 @@
+#include "throughputBenchmark.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <windows.h>
+#include <psapi.h>
+
+#include "../core/batch.h"
+#include "../utils/directoryScanner.h"
+#include "../utils/utils.h"
+#include "../utils/Log.h"
+
+// NOTE GetProcessMemoryInfo is in psapi.lib for old versions of windows
+#pragma comment(lib, "psapi.lib")
+
+namespace // anonymous
+{
+	size_t currentWorkingSet()
+	{
+		PROCESS_MEMORY_COUNTERS counters;
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) == FALSE)
+			return 0u;
+
+		return counters.WorkingSetSize;
+	}
+
+	// peak working set of process can't be reset, so it's sampled during every run
+	class MemoryMonitor
+	{
+	public:
+		MemoryMonitor()
+			: m_stopped(false), m_peak(currentWorkingSet())
+		{
+			m_thread = std::thread([this]() {
+				while (m_stopped == false)
+				{
+					size_t current = currentWorkingSet();
+					if (current > m_peak)
+						m_peak = current;
+
+					std::this_thread::sleep_for(std::chrono::milliseconds(5));
+				}
+			});
+		}
+
+		~MemoryMonitor()
+		{
+			Stop();
+		}
+
+		size_t Stop()
+		{
+			if (m_thread.joinable())
+			{
+				m_stopped = true;
+				m_thread.join();
+			}
+
+			return m_peak;
+		}
+
+	private:
+		std::thread			m_thread;
+		std::atomic<bool>	m_stopped;
+		std::atomic<size_t> m_peak;
+	};
+
+	double findCounter(const pc::bench::BenchmarkResult& result, const std::string& name)
+	{
+		for (const auto& counter : result.counters)
+		{
+			if (counter.first == name)
+				return counter.second;
+		}
+
+		return 0.0;
+	}
+} // namespace anonymous
+
+namespace pc
+{
+namespace bench
+{
+
+ThroughputBenchmark::ThroughputBenchmark(const utils::Parameters& params, const BenchmarkOptions& options)
+	: m_params(params)
+	, m_options(options)
+{
+	// count of workers is set by benchmark
+	m_params.GUI = false;
+	m_params.pipeline = false;
+}
+
+TBenchmarkResults ThroughputBenchmark::Run()
+{
+	TBenchmarkResults results;
+
+	// list of corpus is only kept for eviction of file cache, runs take files from their own scanners
+	utils::filesystem::DirectoryScanner scanner(m_params.inputDirectory, m_params.extensionPattern, m_params.checkSubdirectories);
+	scanner.Start(m_params.scanThreads);
+
+	m_files.clear();
+
+	utils::filesystem::FileEntry file;
+	while (scanner.Next(file))
+		m_files.push_back(file);
+
+	if (m_files.empty())
+	{
+		pc::Log::get().Write("benchmark corpus is empty: " + m_params.inputDirectory, pc::LogLevel::Error);
+		return results;
+	}
+
+	std::vector<int> workers = m_options.workers;
+	if (workers.empty())
+	{
+		// 1, 2, 4 ... hardware threads
+		int hardwareThreads = max(1, int(std::thread::hardware_concurrency()));
+		for (int count = 1; count < hardwareThreads; count *= 2)
+			workers.push_back(count);
+
+		workers.push_back(hardwareThreads);
+	}
+
+	double singleWorkerCold = 0.0;
+	double singleWorkerWarm = 0.0;
+
+	for (int count : workers)
+	{
+		for (int cold = (m_options.coldCache ? 1 : 0); cold >= 0; --cold)
+		{
+			BenchmarkResult result = runOnce(count, cold != 0);
+
+			// speedup relative to one worker divided by count of workers
+			double throughput = findCounter(result, "imagesPerSecond");
+			double& single = cold ? singleWorkerCold : singleWorkerWarm;
+
+			if (count == 1)
+				single = throughput;
+
+			if (single > 0.0)
+				result.counters.push_back(std::make_pair("scalingEfficiency", throughput / single / double(count)));
+
+			results.push_back(result);
+		}
+	}
+
+	return results;
+}
+
+BenchmarkResult ThroughputBenchmark::runOnce(int workersCount, bool coldCache)
+{
+	utils::Parameters params = m_params;
+	params.workersCount = workersCount;
+
+	if (coldCache)
+		evictFileCache();
+
+	BenchmarkResult result;
+	result.name = "throughput/" + std::to_string(workersCount) + "workers/" + (coldCache ? "cold" : "warm");
+
+	MSG_WRITE("run " + result.name);
+
+	MemoryMonitor memory;
+	double cpuStart = GetProcessCpuTime();
+	utils::Timer timer;
+
+	utils::filesystem::DirectoryScanner files(params.inputDirectory, params.extensionPattern, params.checkSubdirectories);
+	files.Start(params.scanThreads);
+
+	BatchProcessor batch(params);
+
+	bool abortedByUser = false;
+	size_t processed = batch.Run(files, abortedByUser);
+
+	double elapsed = timer.ElapsedMs();
+	double cpu = GetProcessCpuTime() - cpuStart;
+	size_t peak = memory.Stop();
+
+	utils::Statistics& stats = batch.GetStatistics();
+	int hardwareThreads = max(1, int(std::thread::hardware_concurrency()));
+
+	result.iterations = (long long)processed;
+	result.realTime = processed > 0u ? elapsed / double(processed) : 0.0;
+	result.cpuTime = processed > 0u ? cpu / double(processed) : 0.0;
+
+	result.counters.push_back(std::make_pair("workers", double(workersCount)));
+	result.counters.push_back(std::make_pair("images", double(processed)));
+	result.counters.push_back(std::make_pair("failed", double(stats.GetTotalFailCount())));
+	result.counters.push_back(std::make_pair("totalTime", elapsed));
+	result.counters.push_back(std::make_pair("imagesPerSecond", elapsed > 0.0 ? double(processed) * 1000.0 / elapsed : 0.0));
+	result.counters.push_back(std::make_pair("megabytesPerSecond", elapsed > 0.0 ? double(stats.GetBytesRead()) / (1024.0 * 1024.0) * 1000.0 / elapsed : 0.0));
+
+	// part of all hardware threads which was busy
+	result.counters.push_back(std::make_pair("cpuUtilization", elapsed > 0.0 ? cpu / (elapsed * hardwareThreads) : 0.0));
+	result.counters.push_back(std::make_pair("peakWorkingSetMB", double(peak) / (1024.0 * 1024.0)));
+
+	return result;
+}
+
+void ThroughputBenchmark::evictFileCache()
+{
+	// NOTE opening file without buffering makes system drop its cached pages
+	// (if nobody else has it opened); there is no way to flush whole cache without admin rights
+	for (const auto& file : m_files)
+	{
+		HANDLE handle = CreateFileA(file.GetPath().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+			OPEN_EXISTING, FILE_FLAG_NO_BUFFERING, nullptr);
+
+		if (handle != INVALID_HANDLE_VALUE)
+			CloseHandle(handle);
+	}
+}
+
+}
+}
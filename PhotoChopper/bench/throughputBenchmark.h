@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+
+#include "benchmark.h"
+#include "../utils/parameters.h"
+#include "../utils/filesystem.h"
+#include "../utils/classutils.h"
+
+namespace pc
+{
+namespace bench
+{
+
+// runs whole batch processing (Open, Process, SaveAs, Close) over input directory
+// with different counts of workers, with cold and warm file cache.
+// Reports throughput, cpu utilisation, peak memory and scaling efficiency
+class ThroughputBenchmark : public utils::noncopyable
+{
+public:
+	ThroughputBenchmark(const utils::Parameters& params, const BenchmarkOptions& options);
+
+	TBenchmarkResults Run();
+
+private:
+	BenchmarkResult runOnce(int workersCount, bool coldCache);
+
+	// removes cached data of input files from system file cache (best effort)
+	void evictFileCache();
+
+private:
+	utils::Parameters m_params;
+	BenchmarkOptions  m_options;
+
+	utils::filesystem::TFiles m_files;
+};
+
+}
+}
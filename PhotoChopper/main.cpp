@@ -1,60 +1,54 @@
 #include <iostream>
 
 #include "core/core.h"
+#include "core/batch.h"
+#include "core/cascadeCache.h"
 #include "utils/statistics.h"
 #include "utils/filesystem.h"
+#include "utils/directoryScanner.h"
 #include "utils/utils.h"
 #include "utils/Log.h"
+#include "utils/matPool.h"
+#include "utils/commandLine.h"
 
-#include <vector>
+#include <cstdio>
 
-void printUsage(const char* programName)
-{
-	std::cout << " Usage: " << programName << " [-i=<input dir>] [-o=<output_dir>] [-s=<path to settings file>]" << std::endl;
-}
+#include <windows.h>
 
-void initialize_log(const pc::utils::Parameters& params)
+enum RunMode
 {
-	pc::Log::init(params.logType);
-	pc::Log::get().SetLogLevel(params.logLevel);
-	pc::Log::get().SetEnabled(params.log);
+	RunBatch,
+	RunCompileCascades
+};
 
-	// TODO refactor this hack
-	if (auto filelog = dynamic_cast<pc::FileLog*>(&pc::Log::get()))
-	{
-		filelog->SetFile(params.logFilename);
-	}
+void printUsage(const char* programName)
+{
+	std::cout << " Usage: " << programName << " [-i=<input dir>] [-o=<output_dir>] [-s=<path to settings file>] [-j=<workers count>]" << std::endl;
+	std::cout << "        " << programName << " -compile-cascades [-s=<path to settings file>]" << std::endl;
 }
 
-int initialize_params(int argc, char** argv, pc::utils::Parameters &params)
+int initialize_params(int argc, char** argv, pc::utils::Parameters &params, RunMode& mode)
 {
-	std::string inputDirectory;
-	std::string outputDirectory;
-	std::string settingsFile;
+	pc::utils::CommandLine commandLine;
 
-	bool setOutputDirectoryFromArguments = false;
-	bool setInputDirectoryFromArguments = false;
-	bool setSettingsFileFromArguments = false;
+	int workersCount = 1;
+	bool setWorkersCountFromArguments = false;
 
 	for (int i = 1; i < argc; ++i)
 	{
 		char* argument = argv[i];
-		if (std::strncmp(argument, "-i=", 3) == 0)
+		if (commandLine.Parse(argument))
 		{
-			setInputDirectoryFromArguments = true;
-			inputDirectory = std::string(argument).substr(3);
-			pc::utils::filesystem::trim_dir_name(inputDirectory);
+			continue;
 		}
-		else if (std::strncmp(argument, "-o=", 3) == 0)
+		else if (std::strncmp(argument, "-j=", 3) == 0)
 		{
-			setOutputDirectoryFromArguments = true;
-			outputDirectory = std::string(argument).substr(3);
-			pc::utils::filesystem::trim_dir_name(outputDirectory);
+			setWorkersCountFromArguments = true;
+			workersCount = std::atoi(argument + 3);
 		}
-		else if (std::strncmp(argument, "-s=", 3) == 0)
+		else if (std::strcmp(argument, "-compile-cascades") == 0)
 		{
-			setSettingsFileFromArguments = true;
-			settingsFile = std::string(argument).substr(3);
+			mode = RunCompileCascades;
 		}
 		else if (std::strncmp(argument, "-h", 2) == 0)
 		{
@@ -67,60 +61,38 @@ int initialize_params(int argc, char** argv, pc::utils::Parameters &params)
 		}
 	}
 
-	if (setSettingsFileFromArguments)
-		params.configFilename = settingsFile;
+	commandLine.Apply(params);
 
-	params.ReadFromFile(params.configFilename);
+	if (setWorkersCountFromArguments)
+		params.workersCount = workersCount;
 
-	if (setOutputDirectoryFromArguments)
-		params.outputDirectory = outputDirectory;
-
-	if (setInputDirectoryFromArguments)
-		params.inputDirectory = inputDirectory;
-	
-	pc::utils::filesystem::createDir(params.outputDirectory);
-
-	if (params.needToCopyResultImageWhenFailed || params.alsoCopyOriginalImageToFailedFolder)
-		pc::utils::filesystem::createDir(params.copyResultImageWhenFailedFolder);
+	if (mode == RunBatch)
+		pc::utils::CreateOutputDirectories(params);
 
 	return 0;
 }
 
-bool processFile(const tinydir_file &file, pc::Processor &processor, const pc::utils::Parameters &params, bool& abortedByUser)
+int compileCascades(const pc::utils::Parameters& params)
 {
-	try
+	const std::string cascades[] = { params.cascadeFrontalFaceTemplate, params.cascadeEyeTemplate };
+
+	int result = 0;
+	for (const auto& cascade : cascades)
 	{
-		processor.Open(file.path);
-		processor.Process();
+		std::string compiled = pc::GetCompiledCascadePath(cascade);
 
-		if (params.saveFiles)
+		if (pc::CompileCascade(cascade, compiled))
 		{
-			processor.SaveAs(params.outputDirectory + "/" + file.name);
+			std::cout << "cascade " << cascade << " is compiled to " << compiled << std::endl;
 		}
-
-		processor.Close();
-	}
-	catch (const std::exception&)
-	{
-		processor.Close();
-	}
-
-	if (params.GUI)
-	{
-		try
+		else
 		{
-
-			processor.ShowOrigin();
-			processor.ShowResult();
-
-			if (pc::utils::WaitForKeyOpenCV() == pc::utils::KeyEscape)
-				abortedByUser = true;
+			std::cout << "ERROR: cant compile cascade " << cascade << std::endl;
+			result = 1;
 		}
-		catch (std::exception&)
-		{ }
 	}
 
-	return !abortedByUser;
+	return result;
 }
 
 void cleanupGUI(const pc::utils::Parameters &params)
@@ -131,7 +103,49 @@ void cleanupGUI(const pc::utils::Parameters &params)
 	}
 }
 
-void printStatistics(pc::Processor &processor, size_t processedCount, size_t expectedCount, bool abortedByUser)
+void printStageTimes(pc::utils::Statistics& stats)
+{
+	using pc::utils::Statistics;
+
+	double seconds = stats.GetTotalTime() / 1000.0;
+	double megabytes = double(stats.GetBytesRead()) / (1024.0 * 1024.0);
+
+	MSG_WRITE("  Total time:       " + std::to_string(seconds) + " s");
+
+	if (seconds > 0.0)
+	{
+		MSG_WRITE("  Throughput:       " + std::to_string(stats.GetTotalProcessedCount() / seconds) + " images/s, "
+			+ std::to_string(megabytes / seconds) + " MB/s");
+	}
+
+	const pc::utils::AllocationCounters& allocations = stats.GetAllocationCounters();
+	if (allocations.allocations > 0u)
+	{
+		MSG_WRITE("  Image buffers:    " + std::to_string(allocations.allocations) + " allocations, "
+			+ std::to_string(allocations.hits * 100u / allocations.allocations) + "% reused, "
+			+ std::to_string(allocations.systemAllocations) + " from system (" + std::to_string(allocations.systemBytes / (1024u * 1024u)) + " MB, "
+			+ std::to_string(allocations.hugePageAllocations) + " in large pages), peak cache " + std::to_string(allocations.peakCachedBytes / (1024u * 1024u)) + " MB");
+	}
+
+	char line[256];
+	sprintf_s(line, "\n  %-18s %8s %10s %10s %10s %10s %10s", "stage (ms)", "count", "mean", "p50", "p95", "p99", "max");
+	MSG_WRITE(line);
+
+	for (int i = 0; i < Statistics::StagesCount; ++i)
+	{
+		Statistics::Stage stage = Statistics::Stage(i);
+		const pc::utils::LatencyHistogram& times = stats.GetStageTimes(stage);
+
+		if (times.GetCount() == 0u)
+			continue;
+
+		sprintf_s(line, "  %-18s %8llu %10.2f %10.2f %10.2f %10.2f %10.2f", Statistics::GetStageName(stage),
+			times.GetCount(), times.GetMean(), times.GetPercentile(50.0), times.GetPercentile(95.0), times.GetPercentile(99.0), times.GetMax());
+		MSG_WRITE(line);
+	}
+}
+
+void printStatistics(pc::utils::Statistics& stats, size_t processedCount, size_t expectedCount, bool abortedByUser)
 {
 	if (processedCount != expectedCount)
 	{
@@ -141,8 +155,6 @@ void printStatistics(pc::Processor &processor, size_t processedCount, size_t exp
 			pc::LogLevel::Warning);
 	}
 
-	pc::utils::Statistics& stats = processor.GetStatistics();
-
 	if (abortedByUser == false)
 	{
 		// check correctness
@@ -163,6 +175,15 @@ void printStatistics(pc::Processor &processor, size_t processedCount, size_t exp
 	MSG_WRITE("  Warnings count:   " + std::to_string(stats.GetWarningsCount()));
 	MSG_WRITE("  Total fail count: " + std::to_string(stats.GetTotalFailCount()));
 
+	// cascades must be parsed once per process, not per image
+	pc::CascadeCache& cascades = pc::CascadeCache::get();
+	double cascadesLoadTime = cascades.GetTotalLoadTime();
+
+	MSG_WRITE("  Cascade loads:    " + std::to_string(cascades.GetLoadsCount()) + " (" + std::to_string(cascadesLoadTime) + " ms, "
+		+ std::to_string(processedCount > 0 ? cascadesLoadTime / double(processedCount) : 0.0) + " ms per image)");
+
+	printStageTimes(stats);
+
 	// TODO print detailed infos for all warnings and errors
 	if (stats.GetWarningsCount() > 0)
 	{
@@ -183,7 +204,8 @@ int main(int argc, char* argv[])
 try
 {
 	pc::utils::Parameters params;
-	if (initialize_params(argc, argv, params) < 0)
+	RunMode mode = RunBatch;
+	if (initialize_params(argc, argv, params, mode) < 0)
 	{
 		printUsage(argv[0]);
 
@@ -192,39 +214,40 @@ try
 		return 1;
 	}
 
-	initialize_log(params);
+	if (mode == RunCompileCascades)
+		return compileCascades(params);
+
+	pc::utils::InitializeLog(params);
+
+	// NOTE pool must be configured before any worker is started
+	pc::utils::MatPool::get().Configure(size_t(max(0, params.matPoolMaxCachedMB)) * 1024u * 1024u, params.matPoolHugePages);
 
 	MSG_WRITE("\n\n===========================================\n"
 				" started new operation " + pc::utils::GetTime() + " " + pc::utils::GetDate() +
 				"\n===========================================\n");
 		
-	pc::utils::filesystem::TFiles files;
-	pc::utils::filesystem::getFilesInDirectory(params.inputDirectory, files, params.extensionPattern, params.checkSubdirectories);
+	// files are processed while directories are still scanned
+	pc::utils::filesystem::DirectoryScanner files(params.inputDirectory, params.extensionPattern, params.checkSubdirectories);
+	files.Start(params.scanThreads);
 
 	// TODO always use absolute path here
-	MSG_WRITE(std::string("try to process ") + std::to_string(files.size()) + " files in " + params.inputDirectory);
+	MSG_WRITE(std::string("try to process files in ") + params.inputDirectory);
 	MSG_WRITE(std::string("Output directory is ") + (params.outputDirectory.empty() ? pc::utils::filesystem::getCurrentDirectory() : params.outputDirectory) + "\n");
 
-	if (files.empty() == false)
-	{
-		pc::Processor processor(params);
-
-		size_t index = 1u;
-		size_t total = files.size();
-
-		bool abortedByUser = false;
-		for (const auto& file : files)
-		{
-			MSG_WRITE(" :: " + std::to_string(index) + "/" + std::to_string(total) + " file: " + file.path + " :: ");
+	pc::BatchProcessor batch(params);
 
-			++index;
+	bool abortedByUser = false;
+	size_t processed = batch.Run(files, abortedByUser);
 
-			if (processFile(file, processor, params, abortedByUser) == false)
-				break;
-		}
+	size_t total = files.GetFoundCount();
 
+	if (total > 0)
+	{
 		cleanupGUI(params);
-		printStatistics(processor, index - 1u, total, abortedByUser);
+		printStatistics(batch.GetStatistics(), processed, total, abortedByUser);
+
+		if (params.statisticsJsonFile.empty() == false && batch.GetStatistics().WriteJson(params.statisticsJsonFile) == false)
+			pc::Log::get().Write("cant write statistics to " + params.statisticsJsonFile, pc::LogLevel::Warning);
 	}
 	else
 	{
@@ -1,10 +1,62 @@
 #include "Log.h"
 
 #include <iostream>
+#include <cstring>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
 
 #include "utils.h"
 #include "filesystem.h"
 
+#include <windows.h>
+
+namespace // anonymous
+{
+	PC_THREAD_LOCAL std::string* g_threadBuffer = nullptr;
+
+	// NOTE messages are small, so ring takes less than 1 Mb
+	const size_t g_ringCapacity = 8192u;
+
+	// max time between message and its output
+	const int g_writerPeriodMs = 10;
+
+	// max size of one batch, so console output isn't delayed by huge amount of messages
+	const size_t g_maxBatchSize = 64u * 1024u;
+
+	std::unique_ptr<pc::Log> g_log;
+	std::atomic<pc::Log*>	 g_logInstance(nullptr);
+	std::once_flag			 g_logCreated;
+
+	LPTOP_LEVEL_EXCEPTION_FILTER g_previousExceptionFilter = nullptr;
+	std::terminate_handler		 g_previousTerminate = nullptr;
+
+	void shutdownLog()
+	{
+		pc::Log::Shutdown();
+	}
+
+	// last messages usually tell the reason of crash, so they are written before process dies
+	LONG WINAPI crashHandler(EXCEPTION_POINTERS* info)
+	{
+		if (pc::Log* log = g_logInstance.load())
+			log->Flush(1000);
+
+		return g_previousExceptionFilter != nullptr ? g_previousExceptionFilter(info) : EXCEPTION_CONTINUE_SEARCH;
+	}
+
+	void terminateHandler()
+	{
+		if (pc::Log* log = g_logInstance.load())
+			log->Flush(1000);
+
+		if (g_previousTerminate != nullptr)
+			g_previousTerminate();
+
+		std::abort();
+	}
+} // namespace anonymous
+
 namespace pc
 {
 
@@ -12,7 +64,16 @@ LogType Log::g_logType = LogToConsole;
 	
 Log::Log()
 	: m_logLevel(LogLevel::Info), m_enabled(true)
+	, m_ring(g_ringCapacity)
+	, m_writerRunning(false), m_stopping(false)
+	, m_pushedCount(0u), m_writtenCount(0u)
 {}
+
+Log::~Log()
+{
+	// NOTE writer must be stopped before derived class is destroyed, it's done by Shutdown at exit
+	stopWriter();
+}
 	
 void Log::init(LogType type)
 {
@@ -22,31 +83,46 @@ void Log::init(LogType type)
 
 Log& Log::get()
 {
-	static std::unique_ptr<Log> log;
+	// NOTE first call must be done after init, before any worker is started
+	Log* log = g_logInstance.load(std::memory_order_acquire);
+	if (log != nullptr)
+		return *log;
 
-	if (log.get() == nullptr)
+	std::call_once(g_logCreated, []()
 	{
 		// create new one
 		switch (g_logType)
 		{
 		case LogToFile:
-			log.reset(new FileLog());
+			g_log.reset(new FileLog());
 			break;
 		case LogToConsole:
-			log.reset(new ConsoleLog());
+			g_log.reset(new ConsoleLog());
 			break;
 		case LogToConsoleAndFile:
-			log.reset(new ConsoleAndFileLog());
+			g_log.reset(new ConsoleAndFileLog());
 			break;
 		default:
 			throw std::exception("unknown log type");
 			break;
 		}
-	}
 
-	static auto& log_ref = *log.get();
+		g_log->startWriter();
+
+		std::atexit(shutdownLog);
+		g_previousExceptionFilter = SetUnhandledExceptionFilter(crashHandler);
+		g_previousTerminate = std::set_terminate(terminateHandler);
+
+		g_logInstance.store(g_log.get(), std::memory_order_release);
+	});
+
+	return *g_logInstance.load(std::memory_order_acquire);
+}
 
-	return log_ref;
+void Log::Shutdown()
+{
+	if (Log* log = g_logInstance.load())
+		log->stopWriter();
 }
 
 void Log::SetLogLevel(LogLevel logLevel)
@@ -56,18 +132,18 @@ void Log::SetLogLevel(LogLevel logLevel)
 
 std::string Log::getStr(const std::string& message, LogLevel loglevel, bool insertNewLine /*= true*/)
 {
-	std::string result;
+	const char* prefix = "";
 
 	switch (loglevel)
 	{
 	case pc::Error:
-		result += "  Error: ";
+		prefix = "  Error: ";
 		break;
 	case pc::Warning:
-		result += "  Warning: ";
+		prefix = "  Warning: ";
 		break;
 	case pc::Info:
-		result += "  Info: ";
+		prefix = "  Info: ";
 		break;
 	case pc::None:
 	case pc::Note:
@@ -77,7 +153,15 @@ std::string Log::getStr(const std::string& message, LogLevel loglevel, bool inse
 		break;
 	}
 
-	result += message + (insertNewLine ? "\n" : "");
+	// NOTE only one allocation for the whole line
+	std::string result;
+	result.reserve(std::strlen(prefix) + message.size() + 1u);
+
+	result += prefix;
+	result += message;
+
+	if (insertNewLine)
+		result += '\n';
 
 	return result;
 }
@@ -90,6 +174,155 @@ bool Log::canWrite(LogLevel logLevel)
 	return isEnabled && (logLevel <= m_logLevel && (logLevel != None && m_logLevel != None));
 }
 
+void Log::Write(const std::string& message, LogLevel loglevel, bool insertNewLine /* = true */)
+{
+	if (canWrite(loglevel) == false)
+		return;
+
+	std::string str = getStr(message, loglevel, insertNewLine);
+
+	if (g_threadBuffer != nullptr)
+	{
+		g_threadBuffer->append(str);
+		return;
+	}
+
+	enqueue(std::move(str));
+}
+
+void Log::SetThreadBuffer(std::string* buffer)
+{
+	g_threadBuffer = buffer;
+}
+
+void Log::Flush(const std::string& buffer)
+{
+	if (buffer.empty())
+		return;
+
+	enqueue(std::string(buffer));
+}
+
+void Log::Flush(int timeoutMs /*= 5000*/)
+{
+	if (m_writerRunning == false)
+		return;
+
+	unsigned long long pushed = m_pushedCount.load();
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+
+	std::unique_lock<std::mutex> lock(m_wakeMutex);
+	m_wake.notify_one();
+
+	// NOTE notifications aren't sent under lock, so wait is limited by period
+	while (m_writtenCount.load() < pushed && m_writerRunning && std::chrono::steady_clock::now() < deadline)
+		m_drained.wait_for(lock, std::chrono::milliseconds(g_writerPeriodMs));
+}
+
+void Log::startWriter()
+{
+	m_stopping = false;
+	m_writerRunning = true;
+	m_writer = std::thread([this]() { writerRoutine(); });
+}
+
+void Log::stopWriter()
+{
+	if (m_writer.joinable() == false)
+		return;
+
+	m_stopping = true;
+	m_wake.notify_one();
+
+	m_writer.join();
+}
+
+void Log::enqueue(std::string&& str)
+{
+	if (m_writerRunning == false)
+	{
+		// before start and after shutdown messages are written directly
+		std::lock_guard<std::mutex> lock(m_mutex);
+		writeStr(str);
+		return;
+	}
+
+	// NOTE if ring is full producer waits for writer, so messages aren't lost
+	while (m_ring.TryPush(std::move(str)) == false)
+	{
+		if (m_writerRunning == false)
+			drainRing();
+
+		m_wake.notify_one();
+		std::this_thread::yield();
+	}
+
+	++m_pushedCount;
+
+	// writer could be stopped after flag was checked, then message is written by this thread
+	if (m_writerRunning == false)
+		drainRing();
+}
+
+void Log::drainRing()
+{
+	// NOTE ring has one consumer, after writer is stopped it's the one who holds lock
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	std::string message;
+	while (m_ring.TryPop(message))
+	{
+		writeStr(message);
+		++m_writtenCount;
+	}
+}
+
+void Log::writerRoutine()
+{
+	std::string batch;
+	std::string message;
+
+	for (;;)
+	{
+		// NOTE flag is read before ring, so everything queued before stop is written
+		bool stopping = m_stopping;
+
+		unsigned long long count = 0u;
+		batch.clear();
+
+		while (batch.size() < g_maxBatchSize && m_ring.TryPop(message))
+		{
+			batch += message;
+			++count;
+		}
+
+		if (count > 0u)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				writeStr(batch);
+			}
+
+			m_writtenCount += count;
+			m_drained.notify_all();
+
+			continue;
+		}
+
+		if (stopping)
+			break;
+
+		std::unique_lock<std::mutex> lock(m_wakeMutex);
+		m_wake.wait_for(lock, std::chrono::milliseconds(g_writerPeriodMs));
+	}
+
+	m_writerRunning = false;
+
+	// messages which were pushed while flag was being reset
+	drainRing();
+	m_drained.notify_all();
+}
+
 void Log::SetEnabled(bool enabled, bool showMessage)
 {
 	if (showMessage)
@@ -115,6 +348,9 @@ void FileLog::SetFile(const std::string& filename)
 				throw std::exception("cant create dir");
 		}
 
+		// NOTE background writer can use file at the same time
+		std::lock_guard<std::mutex> lock(m_mutex);
+
 		m_file.reset(new utils::filesystem::File());
 
 		if (m_file.get() == nullptr)
@@ -124,43 +360,30 @@ void FileLog::SetFile(const std::string& filename)
 	}
 	catch (std::exception& ex)
 	{
+		std::lock_guard<std::mutex> lock(m_mutex);
 		m_file.reset(nullptr);
 		std::cerr << "cant open log file " << filename << std::endl;
 		std::cerr << "    message: " << ex.what() << std::endl;
 	}
 }
 
-void FileLog::Write(const std::string& message, LogLevel loglevel, bool insertNewLine)
+void FileLog::writeStr(const std::string& str)
 {
-	if (m_file.get() && canWrite(loglevel))
+	if (m_file.get())
 	{
-		m_file->Write( getStr(message, loglevel, insertNewLine) );
+		m_file->Write(str);
 	}
 }
 	
-void ConsoleLog::Write(const std::string& message, LogLevel loglevel, bool insertNewLine /* = true */)
-{
-	if (canWrite(loglevel))
-		std::cout << getStr(message, loglevel, insertNewLine);
-}
-
-
-void ConsoleAndFileLog::Write(const std::string& message, LogLevel loglevel, bool insertNewLine)
-{
-	super::Write(message, loglevel, insertNewLine);
-	m_consoleLog.Write(message, loglevel, insertNewLine);
-}
-
-void ConsoleAndFileLog::SetLogLevel(LogLevel logLevel)
+void ConsoleLog::writeStr(const std::string& str)
 {
-	super::SetLogLevel(logLevel);
-	m_consoleLog.SetLogLevel(logLevel);
+	std::cout << str;
 }
 
-void ConsoleAndFileLog::SetEnabled(bool enabled, bool showMessage)
+void ConsoleAndFileLog::writeStr(const std::string& str)
 {
-	super::SetEnabled(enabled, showMessage);
-	m_consoleLog.SetEnabled(enabled, false);
+	super::writeStr(str);
+	std::cout << str;
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -3,10 +3,20 @@
 #include "iLog.h"
 #include "classutils.h"
 
+#include "messageRing.h"
+
 #include <string>
 #include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+
+// message expression is evaluated only if it will be written
+#define LOG_WRITE(x, level) \
+	do { pc::Log& log_ = pc::Log::get(); if (log_.IsEnabled(level)) log_.Write(x, level); } while (false)
 
-#define MSG_WRITE(x) pc::Log::get().Write(x, pc::LogLevel::Note)
+#define MSG_WRITE(x) LOG_WRITE(x, pc::LogLevel::Note)
 
 namespace pc
 {
@@ -20,6 +30,8 @@ namespace filesystem
 } // namespace utils
 
 // interface
+// Messages are put into lock-free ring and written by background thread in batches,
+// so caller never waits for console or file
 class Log : public utils::noncopyable
 {
 public:
@@ -28,39 +40,81 @@ public:
 
 	static Log& get();
 	static void init(LogType logType);
+
+	// write all queued messages and stop background thread (called at exit automatically)
+	static void Shutdown();
 		
 	virtual void SetLogLevel(LogLevel logLevel);
 	virtual void SetEnabled(bool enabled, bool showMessage = true);
 
-	virtual void Write(const std::string& message, LogLevel loglevel, bool insertNewLine = true) = 0;
-	virtual ~Log() {};
+	bool IsEnabled(LogLevel loglevel) { return canWrite(loglevel); }
+
+	virtual void Write(const std::string& message, LogLevel loglevel, bool insertNewLine = true);
+	virtual ~Log();
+
+	// while buffer is set all messages from the calling thread are collected in it
+	// instead of output, so output of one file in batch mode isn't mixed with others
+	static void SetThreadBuffer(std::string* buffer);
+
+	// write collected messages at once
+	void Flush(const std::string& buffer);
+
+	// wait until all queued messages are written, but no longer than timeout
+	void Flush(int timeoutMs = 5000);
 
 protected:
 
 	virtual std::string getStr(const std::string& message, LogLevel loglevel, bool insertNewLine = true);
 	virtual bool canWrite(LogLevel logLevel);
 
+	// NOTE called under lock
+	virtual void writeStr(const std::string& str) = 0;
+
+	void startWriter();
+	void stopWriter();
+	void enqueue(std::string&& str);
+	void drainRing();
+	void writerRoutine();
+
 	static LogType g_logType;
 
 protected:
 
 	LogLevel m_logLevel;
 	bool	 m_enabled;
+
+	std::mutex m_mutex;
+
+private:
+	utils::MessageRing<std::string> m_ring;
+
+	std::thread		  m_writer;
+	std::atomic<bool> m_writerRunning;
+	std::atomic<bool> m_stopping;
+
+	// counters of messages to know when ring is drained
+	std::atomic<unsigned long long> m_pushedCount;
+	std::atomic<unsigned long long> m_writtenCount;
+
+	std::mutex				m_wakeMutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_drained;
 };
 
 class ConsoleLog : public Log
 {
-public:
-	virtual void Write(const std::string& message, LogLevel loglevel, bool insertNewLine /* = true */) override;
+protected:
+	virtual void writeStr(const std::string& str) override;
 };
 
 class FileLog : public Log
 {
 public:
-	virtual void Write(const std::string& message, LogLevel loglevel, bool insertNewLine) override;
-
 	void SetFile(const std::string& filename);
 
+protected:
+	virtual void writeStr(const std::string& str) override;
+
 private:
 	typedef std::unique_ptr<utils::filesystem::File> FilePtr;
 	FilePtr m_file;
@@ -70,14 +124,8 @@ class ConsoleAndFileLog : public FileLog
 {
 	INIT_INHERITANCE(FileLog);
 
-public:
-	virtual void Write(const std::string& message, LogLevel loglevel, bool insertNewLine) override;
-
-	virtual void SetLogLevel(LogLevel logLevel) override;
-	virtual void SetEnabled(bool enabled, bool showMessage) override;
-private:
-
-	ConsoleLog	m_consoleLog;
+protected:
+	virtual void writeStr(const std::string& str) override;
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+#include "classutils.h"
+
+namespace pc
+{
+namespace utils
+{
+
+// blocking multi-producer multi-consumer queue with limited capacity;
+// Push waits while queue is full, so fast producer can't run ahead of consumers
+template <typename T>
+class BoundedQueue : public noncopyable
+{
+public:
+	explicit BoundedQueue(size_t capacity)
+		: m_capacity(capacity > 0 ? capacity : 1)
+		, m_closed(false)
+	{ }
+
+	// returns false if queue is closed
+	bool Push(const T& value)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_notFull.wait(lock, [this]() { return m_closed || m_queue.size() < m_capacity; });
+
+		if (m_closed)
+			return false;
+
+		m_queue.push_back(value);
+		m_notEmpty.notify_one();
+
+		return true;
+	}
+
+	// returns false if queue is closed and there is nothing left
+	bool Pop(T& value)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_notEmpty.wait(lock, [this]() { return m_closed || m_queue.empty() == false; });
+
+		if (m_queue.empty())
+			return false;
+
+		value = m_queue.front();
+		m_queue.pop_front();
+		m_notFull.notify_one();
+
+		return true;
+	}
+
+	// wake up all waiting threads; already queued elements can be still popped
+	void Close()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_closed = true;
+
+		m_notEmpty.notify_all();
+		m_notFull.notify_all();
+	}
+
+	size_t Capacity() const { return m_capacity; }
+
+private:
+	std::deque<T>	m_queue;
+	size_t			m_capacity;
+	bool			m_closed;
+
+	std::mutex				m_mutex;
+	std::condition_variable m_notEmpty;
+	std::condition_variable m_notFull;
+};
+
+}
+}
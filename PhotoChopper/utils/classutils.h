@@ -3,6 +3,9 @@
 #define INIT_INHERITANCE(base) \
 	typedef base super;
 
+// MSVC 2013 doesn't support thread_local keyword (only for POD types)
+#define PC_THREAD_LOCAL __declspec(thread)
+
 namespace pc
 {
 namespace utils
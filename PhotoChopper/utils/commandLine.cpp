@@ -0,0 +1,82 @@
+#include "commandLine.h"
+
+#include <cstring>
+
+#include "filesystem.h"
+#include "Log.h"
+
+namespace pc
+{
+namespace utils
+{
+
+CommandLine::CommandLine()
+	: m_setInputDirectory(false)
+	, m_setOutputDirectory(false)
+	, m_setSettingsFile(false)
+{ }
+
+bool CommandLine::Parse(const char* argument)
+{
+	if (std::strncmp(argument, "-i=", 3) == 0)
+	{
+		m_setInputDirectory = true;
+		m_inputDirectory = std::string(argument).substr(3);
+		filesystem::trim_dir_name(m_inputDirectory);
+	}
+	else if (std::strncmp(argument, "-o=", 3) == 0)
+	{
+		m_setOutputDirectory = true;
+		m_outputDirectory = std::string(argument).substr(3);
+		filesystem::trim_dir_name(m_outputDirectory);
+	}
+	else if (std::strncmp(argument, "-s=", 3) == 0)
+	{
+		m_setSettingsFile = true;
+		m_settingsFile = std::string(argument).substr(3);
+	}
+	else
+	{
+		return false;
+	}
+
+	return true;
+}
+
+void CommandLine::Apply(Parameters& params) const
+{
+	if (m_setSettingsFile)
+		params.configFilename = m_settingsFile;
+
+	params.ReadFromFile(params.configFilename);
+
+	if (m_setOutputDirectory)
+		params.outputDirectory = m_outputDirectory;
+
+	if (m_setInputDirectory)
+		params.inputDirectory = m_inputDirectory;
+}
+
+void CreateOutputDirectories(const Parameters& params)
+{
+	filesystem::createDir(params.outputDirectory);
+
+	if (params.needToCopyResultImageWhenFailed || params.alsoCopyOriginalImageToFailedFolder)
+		filesystem::createDir(params.copyResultImageWhenFailedFolder);
+}
+
+void InitializeLog(const Parameters& params)
+{
+	Log::init(params.logType);
+	Log::get().SetLogLevel(params.logLevel);
+	Log::get().SetEnabled(params.log);
+
+	// TODO refactor this hack
+	if (auto filelog = dynamic_cast<FileLog*>(&Log::get()))
+	{
+		filelog->SetFile(params.logFilename);
+	}
+}
+
+}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+
+#include "parameters.h"
+
+namespace pc
+{
+namespace utils
+{
+
+// arguments which are common for PhotoChopper and PhotoChopperBench:
+// -i=<input dir> -o=<output dir> -s=<settings file>
+class CommandLine
+{
+public:
+	CommandLine();
+
+	// false if argument isn't a common one
+	bool Parse(const char* argument);
+
+	// reads settings file and overrides directories from it by arguments
+	void Apply(Parameters& params) const;
+
+private:
+	std::string m_inputDirectory;
+	std::string m_outputDirectory;
+	std::string m_settingsFile;
+
+	bool m_setInputDirectory;
+	bool m_setOutputDirectory;
+	bool m_setSettingsFile;
+};
+
+// creates output directory and directory for failed images
+void CreateOutputDirectories(const Parameters& params);
+
+// must be called before first use of log
+void InitializeLog(const Parameters& params);
+
+}
+}
@@ -0,0 +1,112 @@
+#include "debugOverlay.h"
+
+#include <opencv2/imgproc.hpp>
+
+namespace pc
+{
+namespace utils
+{
+
+DebugOverlay::DebugOverlay()
+{ }
+
+void DebugOverlay::Reset(const cv::Mat& base /*= cv::Mat()*/)
+{
+	m_base = base;
+
+	// NOTE capacity is kept, so next images don't allocate commands
+	m_commands.clear();
+}
+
+bool DebugOverlay::IsEnabled() const
+{
+	return m_base.empty() == false;
+}
+
+void DebugOverlay::Line(const cv::Point2f& from, const cv::Point2f& to, const cv::Scalar& color, int thickness)
+{
+	Command command;
+	command.type = DrawLine;
+	command.from = from;
+	command.to = to;
+	command.color = color;
+	command.thickness = thickness;
+
+	add(command);
+}
+
+void DebugOverlay::Rectangle(const cv::Rect& rect, const cv::Scalar& color, int thickness)
+{
+	Command command;
+	command.type = DrawRectangle;
+	command.rect = rect;
+	command.color = color;
+	command.thickness = thickness;
+
+	add(command);
+}
+
+void DebugOverlay::Warp(const cv::Mat& affine)
+{
+	Command command;
+	command.type = WarpImage;
+	command.affine = cv::Matx23d(affine);
+
+	add(command);
+}
+
+void DebugOverlay::Crop(const cv::Rect& rect)
+{
+	Command command;
+	command.type = CropImage;
+	command.rect = rect;
+
+	add(command);
+}
+
+void DebugOverlay::add(const Command& command)
+{
+	if (IsEnabled())
+		m_commands.push_back(command);
+}
+
+cv::Mat DebugOverlay::Render() const
+{
+	if (IsEnabled() == false)
+		return cv::Mat();
+
+	cv::Mat image = m_base.clone();
+
+	for (const Command& command : m_commands)
+	{
+		switch (command.type)
+		{
+		case DrawLine:
+			cv::line(image, command.from, command.to, command.color, command.thickness);
+			break;
+
+		case DrawRectangle:
+			cv::rectangle(image, command.rect, command.color, command.thickness);
+			break;
+
+		case WarpImage:
+		{
+			cv::Mat warped;
+			cv::warpAffine(image, warped, cv::Mat(command.affine), image.size(), cv::INTER_LINEAR,
+				cv::BORDER_CONSTANT, cv::Scalar(255, 255, 255));
+
+			image = warped;
+			break;
+		}
+
+		case CropImage:
+			image = image(command.rect & cv::Rect(0, 0, image.cols, image.rows));
+			break;
+		}
+	}
+
+	return image;
+}
+
+}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+namespace pc
+{
+namespace utils
+{
+
+// debug drawings over image (detected regions, lines of eyes, lips, chin...).
+// Primitives are only recorded in coordinates of image and rasterized by Render, when image is really needed
+// (window is shown or image is written), so image which nobody looks at costs nothing.
+// Transformations of image (rotation, crop) are recorded too and applied to image and previous drawings
+class DebugOverlay
+{
+public:
+	DebugOverlay();
+
+	// base image is kept by reference, so it mustn't be changed in place while overlay is used;
+	// empty image turns recording off
+	void Reset(const cv::Mat& base = cv::Mat());
+	bool IsEnabled() const;
+
+	void Line(const cv::Point2f& from, const cv::Point2f& to, const cv::Scalar& color, int thickness);
+	void Rectangle(const cv::Rect& rect, const cv::Scalar& color, int thickness);
+
+	// transformation of image by 2x3 matrix (size is kept, pixels outside of image are white)
+	void Warp(const cv::Mat& affine);
+	void Crop(const cv::Rect& rect);
+
+	// new image with all recorded drawings, empty if recording is turned off
+	cv::Mat Render() const;
+
+private:
+	enum CommandType
+	{
+		DrawLine,
+		DrawRectangle,
+		WarpImage,
+		CropImage
+	};
+
+	struct Command
+	{
+		CommandType type;
+		cv::Point2f from;
+		cv::Point2f to;
+		cv::Rect	rect;
+		cv::Scalar	color;
+		int			thickness;
+		cv::Matx23d affine;
+	};
+
+	void add(const Command& command);
+
+private:
+	cv::Mat				 m_base;
+	std::vector<Command> m_commands;
+};
+
+}
+}
@@ -0,0 +1,150 @@
+#include "directoryScanner.h"
+
+#include <cstring>
+
+#include <windows.h>
+
+namespace pc
+{
+namespace utils
+{
+namespace filesystem
+{
+
+DirectoryScanner::DirectoryScanner(const std::string& path, const std::string& extensionFilter, bool recursive,
+	size_t queueCapacity)
+	: m_path(path)
+	, m_extensionFilter(extensionFilter)
+	, m_recursive(recursive)
+	, m_files(queueCapacity)
+	, m_pendingCount(0u)
+	, m_stopped(false)
+	, m_foundCount(0u)
+{ }
+
+DirectoryScanner::~DirectoryScanner()
+{
+	Stop();
+
+	for (auto& thread : m_threads)
+		thread.join();
+}
+
+void DirectoryScanner::Start(int threadsCount)
+{
+	pushDirectory(std::make_shared<const std::string>(m_path));
+
+	for (int i = 0; i < max(1, threadsCount); ++i)
+		m_threads.emplace_back([this]() { scanRoutine(); });
+}
+
+bool DirectoryScanner::Next(FileEntry& file)
+{
+	return m_files.Pop(file);
+}
+
+void DirectoryScanner::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopped = true;
+		m_directoryAdded.notify_all();
+	}
+
+	m_files.Close();
+}
+
+void DirectoryScanner::pushDirectory(const TDirectory& directory)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_directories.push_back(directory);
+	++m_pendingCount;
+
+	m_directoryAdded.notify_one();
+}
+
+void DirectoryScanner::scanRoutine()
+{
+	for (;;)
+	{
+		TDirectory directory;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_directoryAdded.wait(lock, [this]() { return m_stopped || m_directories.empty() == false || m_pendingCount == 0u; });
+
+			if (m_stopped || m_directories.empty())
+				break;
+
+			directory = m_directories.back();
+			m_directories.pop_back();
+		}
+
+		scanDirectory(directory);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (--m_pendingCount == 0u)
+		{
+			// whole tree is scanned
+			m_directoryAdded.notify_all();
+			m_files.Close();
+		}
+	}
+}
+
+void DirectoryScanner::scanDirectory(const TDirectory& directory)
+{
+	WIN32_FIND_DATAA data;
+	HANDLE handle = FindFirstFileExA((*directory + "/*").c_str(), FindExInfoBasic, &data,
+		FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+
+	if (handle == INVALID_HANDLE_VALUE)
+		return;
+
+	do
+	{
+		const char* name = data.cFileName;
+
+		if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+		{
+			// NOTE links to directories are skipped, they can make a loop
+			if (m_recursive && std::strcmp(".", name) != 0 && std::strcmp("..", name) != 0
+				&& (data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) == 0)
+			{
+				pushDirectory(std::make_shared<const std::string>(*directory + "/" + name));
+			}
+		}
+		else if (matchExtension(name))
+		{
+			FileEntry file;
+			file.directory = directory;
+			file.name = name;
+
+			// NOTE count is increased before push, so consumer never sees file with index greater than count
+			++m_foundCount;
+
+			// queue is closed when scanning is stopped
+			if (m_files.Push(file) == false)
+			{
+				--m_foundCount;
+				break;
+			}
+		}
+	}
+	while (FindNextFileA(handle, &data));
+
+	FindClose(handle);
+}
+
+bool DirectoryScanner::matchExtension(const char* name) const
+{
+	if (m_extensionFilter.empty())
+		return true;
+
+	const char* dot = std::strrchr(name, '.');
+	return dot != nullptr && _stricmp(dot + 1, m_extensionFilter.c_str()) == 0;
+}
+
+}
+}
+}
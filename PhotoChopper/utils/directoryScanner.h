@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "filesystem.h"
+#include "boundedQueue.h"
+#include "classutils.h"
+
+namespace pc
+{
+namespace utils
+{
+namespace filesystem
+{
+
+// walks directory tree by several threads and passes files to consumers as soon as they are found.
+// Found files wait in bounded queue, so scanning is paused while processing is behind
+class DirectoryScanner : public noncopyable
+{
+public:
+	DirectoryScanner(const std::string& path, const std::string& extensionFilter, bool recursive,
+		size_t queueCapacity = 4096u);
+	~DirectoryScanner();
+
+	void Start(int threadsCount = 1);
+
+	// waits for next found file; returns false when all files are taken or scanning is stopped
+	bool Next(FileEntry& file);
+
+	// stops scanning, already found files still can be taken
+	void Stop();
+
+	// count of found files, it's final when Next returned false
+	size_t GetFoundCount() const { return m_foundCount; }
+
+private:
+	typedef std::shared_ptr<const std::string> TDirectory;
+
+	void scanRoutine();
+	void scanDirectory(const TDirectory& directory);
+	void pushDirectory(const TDirectory& directory);
+
+	bool matchExtension(const char* name) const;
+
+private:
+	std::string m_path;
+	std::string m_extensionFilter;
+	bool		m_recursive;
+
+	BoundedQueue<FileEntry> m_files;
+
+	std::vector<TDirectory> m_directories;	// waiting for scanning
+	size_t	m_pendingCount;					// waiting and being scanned
+	bool	m_stopped;
+
+	std::mutex				m_mutex;
+	std::condition_variable m_directoryAdded;
+
+	std::atomic<size_t>		 m_foundCount;
+	std::vector<std::thread> m_threads;
+};
+
+}
+}
+}
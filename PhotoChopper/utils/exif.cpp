@@ -0,0 +1,242 @@
+#include "exif.h"
+
+#include <cstring>
+
+namespace // anonymous
+{
+	const unsigned short g_tagOrientation = 0x0112;
+	const unsigned short g_tagImageWidth = 0x0100;
+	const unsigned short g_tagImageLength = 0x0101;
+
+	const unsigned short g_typeShort = 3;
+	const unsigned short g_typeLong = 4;
+
+	class TiffReader
+	{
+	public:
+		TiffReader(const unsigned char* data, size_t size, bool littleEndian)
+			: m_data(data), m_size(size), m_littleEndian(littleEndian)
+		{ }
+
+		bool Has(size_t offset, size_t count) const { return offset <= m_size && count <= m_size - offset; }
+
+		unsigned short U16(size_t offset) const
+		{
+			const unsigned char* p = m_data + offset;
+			return m_littleEndian ? (unsigned short)(p[0] | (p[1] << 8)) : (unsigned short)((p[0] << 8) | p[1]);
+		}
+
+		unsigned int U32(size_t offset) const
+		{
+			const unsigned char* p = m_data + offset;
+			return m_littleEndian
+				? (unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24)
+				: ((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) | ((unsigned int)p[2] << 8) | (unsigned int)p[3];
+		}
+
+	private:
+		const unsigned char* m_data;
+		size_t m_size;
+		bool   m_littleEndian;
+	};
+
+	// value of SHORT or LONG entry with count 1 (it's stored in entry itself)
+	bool readEntryValue(const TiffReader& reader, size_t entry, unsigned int& value)
+	{
+		unsigned short type = reader.U16(entry + 2);
+		unsigned int count = reader.U32(entry + 4);
+
+		if (count != 1u)
+			return false;
+
+		if (type == g_typeShort)
+			value = reader.U16(entry + 8);
+		else if (type == g_typeLong)
+			value = reader.U32(entry + 8);
+		else
+			return false;
+
+		return true;
+	}
+
+	struct ParseResult
+	{
+		pc::utils::ImageHeader header;
+
+		// position of orientation value in parsed data, to change it in place
+		const unsigned char* orientation;
+		bool littleEndian;
+	};
+
+	// reads first IFD of tiff structure (exif payload or tiff file)
+	bool parseTiff(const unsigned char* data, size_t size, ParseResult& result, bool readSize)
+	{
+		if (size < 8u)
+			return false;
+
+		bool littleEndian = false;
+		if (data[0] == 'I' && data[1] == 'I')
+			littleEndian = true;
+		else if (data[0] != 'M' || data[1] != 'M')
+			return false;
+
+		TiffReader reader(data, size, littleEndian);
+
+		if (reader.U16(2) != 42u)
+			return false;
+
+		size_t ifd = reader.U32(4);
+		if (reader.Has(ifd, 2u) == false)
+			return false;
+
+		size_t count = reader.U16(ifd);
+		if (reader.Has(ifd + 2u, count * 12u) == false)
+			return false;
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			size_t entry = ifd + 2u + i * 12u;
+			unsigned short tag = reader.U16(entry);
+
+			unsigned int value = 0u;
+			if (readEntryValue(reader, entry, value) == false)
+				continue;
+
+			if (tag == g_tagOrientation)
+			{
+				if (value >= 1u && value <= 8u)
+					result.header.orientation = int(value);
+
+				if (reader.U16(entry + 2) == g_typeShort)
+				{
+					result.orientation = data + entry + 8;
+					result.littleEndian = littleEndian;
+				}
+			}
+			else if (readSize && tag == g_tagImageWidth)
+			{
+				result.header.width = int(value);
+			}
+			else if (readSize && tag == g_tagImageLength)
+			{
+				result.header.height = int(value);
+			}
+		}
+
+		return true;
+	}
+
+	bool isStartOfFrame(unsigned char marker)
+	{
+		// SOF0..SOF15 except DHT, JPG and DAC
+		return marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+	}
+
+	bool parseJpeg(const unsigned char* data, size_t size, ParseResult& result)
+	{
+		static const unsigned char exifSignature[6] = { 'E', 'x', 'i', 'f', 0, 0 };
+
+		size_t pos = 2u;
+
+		while (pos + 4u <= size)
+		{
+			if (data[pos] != 0xFF)
+				return false;
+
+			unsigned char marker = data[pos + 1u];
+
+			// fill bytes
+			if (marker == 0xFF)
+			{
+				++pos;
+				continue;
+			}
+
+			// metadata is placed before image data
+			if (marker == 0xDA || marker == 0xD9)
+				break;
+
+			// markers without length
+			if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7))
+			{
+				pos += 2u;
+				continue;
+			}
+
+			size_t length = (size_t(data[pos + 2u]) << 8) | data[pos + 3u];
+			if (length < 2u || pos + 2u + length > size)
+				return false;
+
+			const unsigned char* segment = data + pos + 4u;
+			size_t segmentSize = length - 2u;
+
+			if (marker == 0xE1 && segmentSize > sizeof(exifSignature)
+				&& std::memcmp(segment, exifSignature, sizeof(exifSignature)) == 0)
+			{
+				parseTiff(segment + sizeof(exifSignature), segmentSize - sizeof(exifSignature), result, false);
+			}
+			else if (isStartOfFrame(marker) && segmentSize >= 5u)
+			{
+				result.header.height = (int(segment[1]) << 8) | segment[2];
+				result.header.width = (int(segment[3]) << 8) | segment[4];
+
+				// exif is always before frame header
+				break;
+			}
+
+			pos += 2u + length;
+		}
+
+		return true;
+	}
+
+	bool parseHeader(const unsigned char* data, size_t size, ParseResult& result)
+	{
+		result.header.orientation = 1;
+		result.header.width = 0;
+		result.header.height = 0;
+		result.orientation = nullptr;
+		result.littleEndian = false;
+
+		if (data == nullptr || size < 4u)
+			return false;
+
+		if (data[0] == 0xFF && data[1] == 0xD8)
+			return parseJpeg(data, size, result);
+
+		if ((data[0] == 'I' && data[1] == 'I') || (data[0] == 'M' && data[1] == 'M'))
+			return parseTiff(data, size, result, true);
+
+		return false;
+	}
+} // namespace anonymous
+
+namespace pc
+{
+namespace utils
+{
+
+bool readImageHeader(const unsigned char* data, size_t size, ImageHeader& header)
+{
+	ParseResult result;
+	bool success = parseHeader(data, size, result);
+
+	header = result.header;
+	return success;
+}
+
+bool resetExifOrientation(unsigned char* data, size_t size)
+{
+	ParseResult result;
+	if (parseHeader(data, size, result) == false || result.orientation == nullptr)
+		return false;
+
+	unsigned char* value = data + (result.orientation - data);
+	value[0] = result.littleEndian ? 1 : 0;
+	value[1] = result.littleEndian ? 0 : 1;
+
+	return true;
+}
+
+}
+}
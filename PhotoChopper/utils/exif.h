@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+
+namespace pc
+{
+namespace utils
+{
+
+struct ImageHeader
+{
+	int orientation; // exif orientation 1..8, 1 if there is no exif
+	int width;		 // 0 if unknown
+	int height;
+};
+
+// reads exif orientation and image size from jpeg or tiff header without exiv2,
+// only header segments are touched and nothing is allocated.
+// Returns false if format isn't supported or header is broken
+bool readImageHeader(const unsigned char* data, size_t size, ImageHeader& header);
+
+// sets exif orientation to 1 in place, returns false if there is no orientation in header
+bool resetExifOrientation(unsigned char* data, size_t size);
+
+}
+}
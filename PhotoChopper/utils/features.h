@@ -0,0 +1,8 @@
+#pragma once
+
+// features which can be removed from build (see Headless configuration in PhotoChopper.vcxproj):
+// PC_FEATURE_DISPLAY - windows (highgui), debug overlays and failure images with drawings.
+// Code of the feature is compiled out by #if, checks of runtime settings are combined with the macro
+#ifndef PC_FEATURE_DISPLAY
+#define PC_FEATURE_DISPLAY 1
+#endif
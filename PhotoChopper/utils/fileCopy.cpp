@@ -0,0 +1,184 @@
+#include "fileCopy.h"
+
+#include <iostream>
+
+#include <windows.h>
+#include <winioctl.h>
+
+#include "utils.h"
+
+// block cloning is supported since Windows Server 2016, old SDK doesn't declare it
+#ifndef FSCTL_DUPLICATE_EXTENTS_TO_FILE
+#define FSCTL_DUPLICATE_EXTENTS_TO_FILE CTL_CODE(FILE_DEVICE_FILE_SYSTEM, 209, METHOD_BUFFERED, FILE_WRITE_DATA)
+
+typedef struct _DUPLICATE_EXTENTS_DATA
+{
+	HANDLE		  FileHandle;
+	LARGE_INTEGER SourceFileOffset;
+	LARGE_INTEGER TargetFileOffset;
+	LARGE_INTEGER ByteCount;
+} DUPLICATE_EXTENTS_DATA;
+#endif
+
+namespace // anonymous
+{
+	std::string errorMessage(DWORD code)
+	{
+		char* buffer = nullptr;
+		DWORD length = FormatMessageA(FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
+			nullptr, code, 0, reinterpret_cast<char*>(&buffer), 0, nullptr);
+
+		std::string message = (length > 0 && buffer != nullptr) ? std::string(buffer, length) : "unknown error";
+		LocalFree(buffer);
+
+		// remove line break
+		while (message.empty() == false && (message.back() == '\n' || message.back() == '\r'))
+			message.pop_back();
+
+		return message + " (" + std::to_string(code) + ")";
+	}
+
+	bool setError(std::string* error, const std::string& message)
+	{
+		if (error != nullptr)
+			*error = message;
+
+		return false;
+	}
+
+	bool clusterSize(const std::string& path, unsigned long long& size)
+	{
+		char volume[MAX_PATH];
+		if (GetVolumePathNameA(path.c_str(), volume, MAX_PATH) == FALSE)
+			return false;
+
+		DWORD sectorsPerCluster = 0, bytesPerSector = 0, freeClusters = 0, totalClusters = 0;
+		if (GetDiskFreeSpaceA(volume, &sectorsPerCluster, &bytesPerSector, &freeClusters, &totalClusters) == FALSE)
+			return false;
+
+		size = (unsigned long long)sectorsPerCluster * bytesPerSector;
+		return size > 0u;
+	}
+
+	bool cloneFile(const std::string& src, const std::string& dst, bool failIfExist, std::string* error)
+	{
+		HANDLE source = CreateFileA(src.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (source == INVALID_HANDLE_VALUE)
+			return setError(error, "cant open source: " + errorMessage(GetLastError()));
+
+		HANDLE target = CreateFileA(dst.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+			failIfExist ? CREATE_NEW : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (target == INVALID_HANDLE_VALUE)
+		{
+			DWORD code = GetLastError();
+			CloseHandle(source);
+			return setError(error, "cant create destination: " + errorMessage(code));
+		}
+
+		bool success = false;
+		std::string reason;
+
+		LARGE_INTEGER size;
+		unsigned long long cluster = 0u;
+
+		if (GetFileSizeEx(source, &size) == FALSE || clusterSize(dst, cluster) == false)
+		{
+			reason = errorMessage(GetLastError());
+		}
+		else if (SetFilePointerEx(target, size, nullptr, FILE_BEGIN) == FALSE || SetEndOfFile(target) == FALSE)
+		{
+			reason = errorMessage(GetLastError());
+		}
+		else
+		{
+			// NOTE regions must be aligned to clusters, last one can go beyond the end of file
+			const unsigned long long chunk = 1ull << 30;
+			unsigned long long total = ((unsigned long long)size.QuadPart + cluster - 1u) / cluster * cluster;
+
+			success = true;
+			for (unsigned long long offset = 0u; offset < total && success; offset += chunk)
+			{
+				DUPLICATE_EXTENTS_DATA data;
+				data.FileHandle = source;
+				data.SourceFileOffset.QuadPart = LONGLONG(offset);
+				data.TargetFileOffset.QuadPart = LONGLONG(offset);
+				data.ByteCount.QuadPart = LONGLONG(min(chunk, total - offset));
+
+				DWORD returned = 0;
+				if (DeviceIoControl(target, FSCTL_DUPLICATE_EXTENTS_TO_FILE, &data, sizeof(data), nullptr, 0, &returned, nullptr) == FALSE)
+				{
+					reason = errorMessage(GetLastError());
+					success = false;
+				}
+			}
+		}
+
+		CloseHandle(target);
+		CloseHandle(source);
+
+		if (success == false)
+		{
+			DeleteFileA(dst.c_str());
+			return setError(error, "block cloning isn't possible: " + reason);
+		}
+
+		return true;
+	}
+
+	bool hardLink(const std::string& src, const std::string& dst, bool failIfExist, std::string* error)
+	{
+		// link can't replace existing file
+		if (failIfExist == false)
+			DeleteFileA(dst.c_str());
+
+		if (CreateHardLinkA(dst.c_str(), src.c_str(), nullptr) == FALSE)
+			return setError(error, "cant create hard link: " + errorMessage(GetLastError()));
+
+		return true;
+	}
+} // namespace anonymous
+
+namespace pc
+{
+namespace utils
+{
+namespace filesystem
+{
+
+CopyMode CopyModeFromString(const std::string& modestr)
+{
+	std::string str = modestr;
+	utils::to_lower(str);
+
+	if (str == "copy")
+		return CopyContent;
+	else if (str == "clone")
+		return CopyClone;
+	else if (str == "hardlink")
+		return CopyHardLink;
+	else
+	{
+		std::cout << "WARNING: value of copyMode from settings file is unknown (" << (modestr.empty() ? "<emtpy>" : modestr) << "); set default value" << std::endl;
+		return CopyContent;
+	}
+}
+
+bool copyFile(const std::string& src, const std::string& dst, bool failIfExist /*= false*/,
+	CopyMode mode /*= CopyContent*/, std::string* error /*= nullptr*/)
+{
+	// NOTE fast ways work only on the same volume, otherwise file is copied as usual
+	if (mode == CopyHardLink && hardLink(src, dst, failIfExist, nullptr))
+		return true;
+
+	if (mode == CopyClone && cloneFile(src, dst, failIfExist, nullptr))
+		return true;
+
+	if (CopyFileExA(src.c_str(), dst.c_str(), nullptr, nullptr, nullptr, failIfExist ? COPY_FILE_FAIL_IF_EXISTS : 0) == FALSE)
+		return setError(error, errorMessage(GetLastError()));
+
+	return true;
+}
+
+}
+}
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+
+namespace pc
+{
+namespace utils
+{
+namespace filesystem
+{
+
+// how file is copied; clone and hard link fall back to usual copy when they aren't possible
+enum CopyMode
+{
+	CopyContent,	// by system copy routine (no user space buffers, server side copy on network shares)
+	CopyClone,		// by block cloning (ReFS), data is shared until one of files is changed
+	CopyHardLink	// new name of the same file, so copy mustn't be changed
+};
+
+CopyMode CopyModeFromString(const std::string& modestr);
+
+// returns false if file isn't copied, then reason is written to error
+bool copyFile(const std::string& src, const std::string& dst, bool failIfExist = false,
+	CopyMode mode = CopyContent, std::string* error = nullptr);
+
+}
+}
+}
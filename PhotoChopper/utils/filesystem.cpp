@@ -12,6 +12,7 @@
 #include <windows.h>
 
 #include "utils.h"
+#include "directoryScanner.h"
 
 namespace // anonymous
 {
@@ -141,6 +142,28 @@ std::string getFilename(const std::string& path, std::string* dir)
 	return path.substr(pos + 1u);
 }
 
+std::string getOutputPath(const std::string& path, const std::string& inputDirectory, const std::string& outputDirectory)
+{
+	std::string dir;
+	std::string name = getFilename(path, &dir);
+
+	std::string subdirectory;
+	if (dir.compare(0, inputDirectory.size(), inputDirectory) == 0)
+	{
+		std::string::size_type start = dir.find_first_not_of("/\\", inputDirectory.size());
+		if (start != std::string::npos)
+			subdirectory = dir.substr(start);
+	}
+
+	if (subdirectory.empty())
+		return outputDirectory + "/" + name;
+
+	std::string outputSubdirectory = outputDirectory + "/" + subdirectory;
+	createDir(outputSubdirectory);
+
+	return outputSubdirectory + "/" + name;
+}
+
 std::string getExtension(const std::string& path, std::string* filenameWithoutExtension)
 {
 	std::string extension;
@@ -159,25 +182,6 @@ std::string getExtension(const std::string& path, std::string* filenameWithoutEx
 	return extension;
 }
 
-bool copyFile(const std::string& src, const std::string& dst, bool failIfExist /*= false*/)
-{
-	std::ifstream source(src, std::ios::binary);
-	std::ofstream dest(dst, std::ios::binary);
-	
-	if (!source || !dest)
-		return false;
-
-	std::istreambuf_iterator<char> begin_source(source);
-	std::istreambuf_iterator<char> end_source;
-	std::ostreambuf_iterator<char> begin_dest(dest);
-	std::copy(begin_source, end_source, begin_dest);
-
-	if (!source || !dest)
-		return false;
-
-	return true;
-}
-
 bool createDir(const std::string& path)
 {
 	bool result = _createDir(path);
@@ -254,6 +258,18 @@ bool fileExists(const std::string& path)
 	return true;    // this is not a directory!
 }
 
+bool getFileSizeAndTime(const std::string& path, unsigned long long& size, unsigned long long& lastWriteTime)
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data) == FALSE)
+		return false;
+
+	size = ((unsigned long long)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+	lastWriteTime = ((unsigned long long)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+
+	return true;
+}
+
 bool isUNCServer(const std::string& path)
 {
 	if (path.length() > 2 && path.substr(0, 2) == "\\\\")
@@ -301,38 +317,12 @@ std::string& trim_dir_name(std::string& dir)
 void getFilesInDirectory(const std::string& path, TFiles& files,
 	const std::string& extensionFilter, bool recursive)
 {
-	bool checkExtension = extensionFilter.empty() == false;
-
-	tinydir_dir dir;
-	if (tinydir_open(&dir, path.c_str()) < 0)
-		return;
-
-	while (dir.has_next)
-	{
-		tinydir_file file;
-		if (tinydir_readfile(&dir, &file) < 0)
-			continue;
-
-		if (strcmp(".", file.name) != 0 && strcmp("..", file.name) != 0)
-		{
-			if (file.is_dir && recursive)
-				return getFilesInDirectory(file.path, files, extensionFilter, recursive);
-			else
-			{
-				bool success = true;
-
-				if (checkExtension)
-					success = pc::utils::to_lower(std::string(file.extension)) == extensionFilter;
-
-				if (success)
-					files.push_back(file);
-			}
-		}
-
-		tinydir_next(&dir);
-	}
+	DirectoryScanner scanner(path, extensionFilter, recursive);
+	scanner.Start();
 
-	tinydir_close(&dir);
+	FileEntry file;
+	while (scanner.Next(file))
+		files.push_back(file);
 }
 
 }
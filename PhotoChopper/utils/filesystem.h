@@ -1,9 +1,10 @@
 #pragma once
 
+#include <memory>
 #include <string>
 #include <vector>
 
-#include "../external/tinydir/tinydir.h"
+#include "fileCopy.h"
 
 namespace pc
 {
@@ -33,9 +34,18 @@ protected:
 	bool _isValid();
 };
 
-typedef std::vector<tinydir_file> TFiles;
+// found file; path of directory is shared by all its files, so list of files is compact
+struct FileEntry
+{
+	std::shared_ptr<const std::string> directory;
+	std::string name;
+
+	std::string GetPath() const { return *directory + "/" + name; }
+};
+
+typedef std::vector<FileEntry> TFiles;
 
-//   
+// collects all files at once, see DirectoryScanner for processing of files while they are found
 void getFilesInDirectory(const std::string& path, TFiles& files,
 	const std::string& extensionFilter, bool recursive = false);
 
@@ -43,9 +53,12 @@ std::string getFilename(const std::string& path, std::string* dir = nullptr);
 std::string getExtension(const std::string& path, std::string* filenameWithoutExtension = nullptr);
 std::string& trim_dir_name(std::string& dir);
 
-bool copyFile(const std::string& src, const std::string& dst, bool failIfExist = false);
+// path of result of file which keeps its subdirectory relative to input directory, so same-named files
+// of different subdirectories don't overwrite each other; subdirectory of output is created when it's needed
+std::string getOutputPath(const std::string& path, const std::string& inputDirectory, const std::string& outputDirectory);
 
 bool fileExists(const std::string& path);
+bool getFileSizeAndTime(const std::string& path, unsigned long long& size, unsigned long long& lastWriteTime);
 bool dirExists(const std::string& path);
 bool createFile(const std::string& path, bool failIfExists = true);
 bool createDir(const std::string& path);
@@ -0,0 +1,110 @@
+#include "latencyHistogram.h"
+
+namespace pc
+{
+namespace utils
+{
+
+LatencyHistogram::LatencyHistogram()
+{
+	Reset();
+}
+
+void LatencyHistogram::Reset()
+{
+	for (int i = 0; i < BucketsCount; ++i)
+		m_buckets[i] = 0u;
+
+	m_count = 0u;
+	m_total = 0u;
+	m_max = 0u;
+}
+
+int LatencyHistogram::bucketIndex(unsigned long long value)
+{
+	// first buckets are exact
+	if (value < LinearBucketsCount)
+		return int(value);
+
+	int shift = 1;
+	while ((value >> shift) >= LinearBucketsCount)
+		++shift;
+
+	int index = LinearBucketsCount + (shift - 1) * SubBucketsCount + int(value >> shift) - SubBucketsCount;
+	return index < BucketsCount ? index : BucketsCount - 1;
+}
+
+unsigned long long LatencyHistogram::bucketValue(int index)
+{
+	if (index < LinearBucketsCount)
+		return (unsigned long long)index;
+
+	int shift = (index - LinearBucketsCount) / SubBucketsCount + 1;
+	unsigned long long top = (unsigned long long)((index - LinearBucketsCount) % SubBucketsCount + SubBucketsCount);
+
+	// middle of bucket
+	return (top << shift) + ((1ull << shift) >> 1);
+}
+
+void LatencyHistogram::Record(double ms)
+{
+	unsigned long long value = ms > 0.0 ? (unsigned long long)(ms * 1000.0 + 0.5) : 0u;
+
+	++m_buckets[bucketIndex(value)];
+	++m_count;
+	m_total += value;
+
+	unsigned long long max = m_max.load();
+	while (value > max && m_max.compare_exchange_weak(max, value) == false)
+	{ }
+}
+
+unsigned long long LatencyHistogram::GetCount() const
+{
+	return m_count;
+}
+
+double LatencyHistogram::GetTotal() const
+{
+	return double(m_total.load()) / 1000.0;
+}
+
+double LatencyHistogram::GetMean() const
+{
+	unsigned long long count = m_count;
+	return count > 0u ? GetTotal() / double(count) : 0.0;
+}
+
+double LatencyHistogram::GetMax() const
+{
+	return double(m_max.load()) / 1000.0;
+}
+
+double LatencyHistogram::GetPercentile(double percentile) const
+{
+	unsigned long long count = m_count;
+	if (count == 0u)
+		return 0.0;
+
+	// rank of value which isn't less than given percent of all values
+	unsigned long long rank = (unsigned long long)(percentile / 100.0 * double(count) + 0.5);
+	rank = rank < 1u ? 1u : (rank > count ? count : rank);
+
+	unsigned long long accumulated = 0u;
+	for (int i = 0; i < BucketsCount; ++i)
+	{
+		accumulated += m_buckets[i];
+		if (accumulated >= rank)
+		{
+			// NOTE bucket middle can be greater than real max
+			unsigned long long value = bucketValue(i);
+			unsigned long long max = m_max;
+			return double(value < max ? value : max) / 1000.0;
+		}
+	}
+
+	return GetMax();
+}
+
+}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+
+#include "classutils.h"
+
+namespace pc
+{
+namespace utils
+{
+
+// thread-safe histogram of durations with bounded relative error (like HdrHistogram):
+// values are kept in microseconds, every power of two range is split into equal sub-buckets,
+// so percentiles are precise to ~3% with fixed memory
+class LatencyHistogram : public noncopyable
+{
+public:
+	LatencyHistogram();
+
+	void Reset();
+
+	void Record(double ms);
+
+	unsigned long long GetCount() const;
+
+	// all values are in milliseconds
+	double GetTotal() const;
+	double GetMean() const;
+	double GetMax() const;
+
+	// percentile in [0, 100]
+	double GetPercentile(double percentile) const;
+
+private:
+	static const int SubBucketsCount = 32;
+	static const int LinearBucketsCount = 2 * SubBucketsCount;
+
+	// values up to ~2^36 us (19 hours)
+	static const int BucketsCount = LinearBucketsCount + 31 * SubBucketsCount;
+
+	static int bucketIndex(unsigned long long value);
+	static unsigned long long bucketValue(int index);
+
+private:
+	std::atomic<unsigned long long> m_buckets[BucketsCount];
+
+	std::atomic<unsigned long long> m_count;
+	std::atomic<unsigned long long> m_total;
+	std::atomic<unsigned long long> m_max;
+};
+
+}
+}
@@ -0,0 +1,321 @@
+#include "matPool.h"
+
+#include <windows.h>
+
+#include "Log.h"
+
+namespace // anonymous
+{
+	// smaller buffers are allocated as usual, heap handles them well
+	const size_t g_minPooledSize = 64 * 1024;
+
+	// bigger buffers are allocated by pages directly (and can be in large pages)
+	const size_t g_pageAllocationSize = 2 * 1024 * 1024;
+
+	// 8 size classes per power of two, so no more than 1/8 of buffer is unused
+	size_t sizeClass(size_t size)
+	{
+		int power = 0;
+		while ((size_t(1) << (power + 1)) <= size)
+			++power;
+
+		size_t step = size_t(1) << (power - 3);
+		return (size + step - 1) / step * step;
+	}
+
+	// large pages can be allocated only by process with SeLockMemoryPrivilege
+	bool enableLockMemoryPrivilege()
+	{
+		HANDLE token = nullptr;
+		if (OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token) == FALSE)
+			return false;
+
+		TOKEN_PRIVILEGES privileges;
+		privileges.PrivilegeCount = 1;
+		privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+
+		// NOTE AdjustTokenPrivileges succeeds even if privilege isn't assigned to user, it's reported by last error
+		bool result = LookupPrivilegeValueA(nullptr, "SeLockMemoryPrivilege", &privileges.Privileges[0].Luid) != FALSE
+			&& AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr) != FALSE
+			&& GetLastError() == ERROR_SUCCESS;
+
+		CloseHandle(token);
+		return result;
+	}
+} // namespace anonymous
+
+namespace pc
+{
+namespace utils
+{
+
+MatPool& MatPool::get()
+{
+	static MatPool* pool = new MatPool();
+	return *pool;
+}
+
+MatPool::MatPool()
+	: m_maxCachedBytes(0u)
+	, m_hugePages(false)
+	, m_largePageSize(0u)
+	, m_cachedBytes(0u)
+{
+	for (int i = 0; i < ShardsCount; ++i)
+		m_shards[i].reset(new Shard());
+
+	ResetCounters();
+}
+
+void MatPool::Configure(size_t maxCachedBytes, bool hugePages)
+{
+	m_maxCachedBytes = maxCachedBytes;
+
+	if (hugePages && m_hugePages == false)
+	{
+		m_largePageSize = GetLargePageMinimum();
+
+		if (m_largePageSize > 0u && enableLockMemoryPrivilege())
+			m_hugePages = true;
+		else
+			pc::Log::get().Write("large pages aren't available (SeLockMemoryPrivilege is required), usual pages are used", pc::LogLevel::Warning);
+	}
+	else if (hugePages == false)
+	{
+		m_hugePages = false;
+	}
+
+	if (maxCachedBytes == 0u)
+		Trim();
+}
+
+bool MatPool::IsEnabled() const
+{
+	return m_maxCachedBytes > 0u;
+}
+
+void MatPool::Attach(cv::Mat& mat)
+{
+	if (IsEnabled())
+		mat.allocator = this;
+}
+
+void MatPool::Trim()
+{
+	for (int i = 0; i < ShardsCount; ++i)
+	{
+		Shard& shard = *m_shards[i];
+		std::lock_guard<std::mutex> lock(shard.mutex);
+
+		for (auto& buffers : shard.buffers)
+		{
+			for (void* buffer : buffers.second)
+			{
+				freeBuffer(buffer, buffers.first);
+				m_cachedBytes -= buffers.first;
+			}
+		}
+
+		shard.buffers.clear();
+	}
+}
+
+AllocationCounters MatPool::GetCounters() const
+{
+	AllocationCounters counters;
+	counters.allocations = m_allocations;
+	counters.hits = m_hits;
+	counters.systemAllocations = m_systemAllocations;
+	counters.hugePageAllocations = m_hugePageAllocations;
+	counters.systemBytes = m_systemBytes;
+	counters.cachedBytes = m_cachedBytes;
+	counters.peakCachedBytes = m_peakCachedBytes;
+
+	return counters;
+}
+
+void MatPool::ResetCounters()
+{
+	m_allocations = 0u;
+	m_hits = 0u;
+	m_systemAllocations = 0u;
+	m_hugePageAllocations = 0u;
+	m_systemBytes = 0u;
+	m_peakCachedBytes = size_t(m_cachedBytes);
+}
+
+cv::UMatData* MatPool::allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+	int flags, cv::UMatUsageFlags usageFlags) const
+{
+	// user buffers aren't owned by mat
+	if (data != nullptr)
+		return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usageFlags);
+
+	// continuous storage, as standard allocator makes it
+	size_t total = CV_ELEM_SIZE(type);
+	for (int i = dims - 1; i >= 0; --i)
+	{
+		if (step != nullptr)
+			step[i] = total;
+
+		total *= size_t(sizes[i]);
+	}
+
+	uchar* buffer = nullptr;
+	if (total < g_minPooledSize)
+	{
+		buffer = static_cast<uchar*>(cv::fastMalloc(total));
+	}
+	else
+	{
+		++m_allocations;
+
+		size_t size = sizeClass(total);
+
+		buffer = static_cast<uchar*>(take(size));
+		if (buffer != nullptr)
+			++m_hits;
+		else
+			buffer = static_cast<uchar*>(allocateBuffer(size));
+	}
+
+	cv::UMatData* u = new cv::UMatData(this);
+	u->data = u->origdata = buffer;
+	u->size = total;
+
+	return u;
+}
+
+bool MatPool::allocate(cv::UMatData* data, int /*accessflags*/, cv::UMatUsageFlags /*usageFlags*/) const
+{
+	return data != nullptr;
+}
+
+void MatPool::deallocate(cv::UMatData* u) const
+{
+	if (u == nullptr)
+		return;
+
+	CV_Assert(u->urefcount == 0);
+	CV_Assert(u->refcount == 0);
+
+	if ((u->flags & cv::UMatData::USER_ALLOCATED) == 0)
+	{
+		if (u->size < g_minPooledSize)
+		{
+			cv::fastFree(u->origdata);
+		}
+		else
+		{
+			size_t size = sizeClass(u->size);
+			if (put(u->origdata, size) == false)
+				freeBuffer(u->origdata, size);
+		}
+
+		u->origdata = 0;
+	}
+
+	delete u;
+}
+
+MatPool::Shard& MatPool::currentShard() const
+{
+	// NOTE ids of windows threads are multiples of 4, low bits would select only every 4th shard
+	return *m_shards[(GetCurrentThreadId() >> 2) % ShardsCount];
+}
+
+void* MatPool::take(size_t size) const
+{
+	Shard& own = currentShard();
+
+	// buffers released by other threads are taken only if own shard is empty (e.g. in pipeline mode
+	// images are decoded and released by different workers)
+	for (int i = -1; i < ShardsCount; ++i)
+	{
+		Shard& shard = (i < 0) ? own : *m_shards[i];
+		if (i >= 0 && &shard == &own)
+			continue;
+
+		std::unique_lock<std::mutex> lock(shard.mutex, std::defer_lock);
+		if (i < 0)
+			lock.lock();
+		else if (lock.try_lock() == false)
+			continue;
+
+		auto it = shard.buffers.find(size);
+		if (it == shard.buffers.end() || it->second.empty())
+			continue;
+
+		void* buffer = it->second.back();
+		it->second.pop_back();
+
+		m_cachedBytes -= size;
+		return buffer;
+	}
+
+	return nullptr;
+}
+
+bool MatPool::put(void* buffer, size_t size) const
+{
+	size_t cached = (m_cachedBytes += size);
+	if (cached > m_maxCachedBytes)
+	{
+		m_cachedBytes -= size;
+		return false;
+	}
+
+	size_t peak = m_peakCachedBytes;
+	while (cached > peak && m_peakCachedBytes.compare_exchange_weak(peak, cached) == false)
+	{ }
+
+	Shard& shard = currentShard();
+	std::lock_guard<std::mutex> lock(shard.mutex);
+
+	shard.buffers[size].push_back(buffer);
+	return true;
+}
+
+void* MatPool::allocateBuffer(size_t size) const
+{
+	void* buffer = nullptr;
+
+	if (size >= g_pageAllocationSize)
+	{
+		if (m_hugePages)
+		{
+			size_t largeSize = (size + m_largePageSize - 1u) / m_largePageSize * m_largePageSize;
+			buffer = VirtualAlloc(nullptr, largeSize, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+
+			if (buffer != nullptr)
+				++m_hugePageAllocations;
+		}
+
+		// NOTE large pages can be unavailable because of fragmentation of physical memory
+		if (buffer == nullptr)
+			buffer = VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+
+		if (buffer == nullptr)
+			throw std::exception("out of memory: cant allocate image buffer");
+	}
+	else
+	{
+		buffer = cv::fastMalloc(size);
+	}
+
+	++m_systemAllocations;
+	m_systemBytes += size;
+
+	return buffer;
+}
+
+void MatPool::freeBuffer(void* buffer, size_t size) const
+{
+	if (size >= g_pageAllocationSize)
+		VirtualFree(buffer, 0, MEM_RELEASE);
+	else
+		cv::fastFree(buffer);
+}
+
+}
+}
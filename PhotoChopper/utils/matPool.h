@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "classutils.h"
+#include "statistics.h"
+
+namespace pc
+{
+namespace utils
+{
+
+// allocator of cv::Mat storage which keeps released buffers and gives them to next mats of the same size class,
+// so big image buffers aren't returned to system and page faulted again for every image.
+// Buffers are cached in shards by thread, mats are usually allocated and released by the same worker.
+// Small buffers are allocated as usual
+class MatPool : public cv::MatAllocator, public noncopyable
+{
+public:
+	// NOTE first call must be done from main thread before any worker is started.
+	// Pool is never destroyed, because mats can be released after end of main
+	static MatPool& get();
+
+	// maxCachedBytes - limit of memory kept in released buffers, 0 - pool is turned off;
+	// hugePages - buffers greater than 2 MB are allocated in large pages when process has the privilege
+	void Configure(size_t maxCachedBytes, bool hugePages);
+	bool IsEnabled() const;
+
+	// storage of mat will be taken from pool when mat is allocated next time (if pool is turned on)
+	void Attach(cv::Mat& mat);
+
+	// releases all cached buffers to system
+	void Trim();
+
+	AllocationCounters GetCounters() const;
+	void ResetCounters();
+
+	// cv::MatAllocator
+	virtual cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+		int flags, cv::UMatUsageFlags usageFlags) const;
+	virtual bool allocate(cv::UMatData* data, int accessflags, cv::UMatUsageFlags usageFlags) const;
+	virtual void deallocate(cv::UMatData* data) const;
+
+private:
+	MatPool();
+
+	static const int ShardsCount = 16;
+
+	struct Shard
+	{
+		std::mutex mutex;
+		std::map<size_t, std::vector<void*>> buffers; // by size class
+	};
+
+	Shard& currentShard() const;
+
+	// buffer of size class from cache, nullptr if there is no one
+	void* take(size_t size) const;
+	bool  put(void* buffer, size_t size) const;
+
+	void* allocateBuffer(size_t size) const;
+	void  freeBuffer(void* buffer, size_t size) const;
+
+private:
+	std::atomic<size_t> m_maxCachedBytes;
+	std::atomic<bool>	m_hugePages;
+	size_t				m_largePageSize;
+
+	std::unique_ptr<Shard> m_shards[ShardsCount];
+
+	mutable std::atomic<size_t> m_cachedBytes;
+
+	mutable std::atomic<unsigned long long> m_allocations;
+	mutable std::atomic<unsigned long long> m_hits;
+	mutable std::atomic<unsigned long long> m_systemAllocations;
+	mutable std::atomic<unsigned long long> m_hugePageAllocations;
+	mutable std::atomic<unsigned long long> m_systemBytes;
+	mutable std::atomic<size_t>				m_peakCachedBytes;
+};
+
+}
+}
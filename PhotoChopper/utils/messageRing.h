@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+#include "classutils.h"
+
+namespace pc
+{
+namespace utils
+{
+
+// lock-free ring buffer with limited capacity for many producers and one consumer.
+// Every cell has sequence number which tells whether it's free for producer
+// or filled for consumer, so producers only compete for the write position
+template <typename T>
+class MessageRing : public noncopyable
+{
+public:
+	// NOTE capacity is rounded up to power of two
+	explicit MessageRing(size_t capacity)
+		: m_mask(0u)
+		, m_enqueuePos(0u)
+		, m_dequeuePos(0u)
+	{
+		size_t size = 2u;
+		while (size < capacity)
+			size <<= 1;
+
+		m_mask = size - 1u;
+		m_cells.reset(new Cell[size]);
+
+		for (size_t i = 0; i < size; ++i)
+			m_cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	// can be called from any thread; returns false if ring is full
+	bool TryPush(T&& value)
+	{
+		Cell* cell = nullptr;
+		size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+
+		for (;;)
+		{
+			cell = &m_cells[pos & m_mask];
+			size_t sequence = cell->sequence.load(std::memory_order_acquire);
+			ptrdiff_t diff = ptrdiff_t(sequence) - ptrdiff_t(pos);
+
+			if (diff == 0)
+			{
+				if (m_enqueuePos.compare_exchange_weak(pos, pos + 1u, std::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0)
+			{
+				return false;
+			}
+			else
+			{
+				pos = m_enqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+
+		cell->value = std::move(value);
+		cell->sequence.store(pos + 1u, std::memory_order_release);
+
+		return true;
+	}
+
+	// NOTE must be called only from one (consumer) thread; returns false if ring is empty
+	bool TryPop(T& value)
+	{
+		Cell& cell = m_cells[m_dequeuePos & m_mask];
+		size_t sequence = cell.sequence.load(std::memory_order_acquire);
+
+		if (ptrdiff_t(sequence) - ptrdiff_t(m_dequeuePos + 1u) < 0)
+			return false;
+
+		value = std::move(cell.value);
+		cell.sequence.store(m_dequeuePos + m_mask + 1u, std::memory_order_release);
+		++m_dequeuePos;
+
+		return true;
+	}
+
+	size_t Capacity() const { return m_mask + 1u; }
+
+private:
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		T					value;
+	};
+
+	std::unique_ptr<Cell[]> m_cells;
+	size_t m_mask;
+
+	// positions are kept in different cache lines, so producers don't slow down consumer
+	char m_padding0[64];
+	std::atomic<size_t> m_enqueuePos;
+	char m_padding1[64];
+	size_t m_dequeuePos;
+};
+
+}
+}
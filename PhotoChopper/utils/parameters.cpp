@@ -2,6 +2,7 @@
 
 #include "iLog.h"
 #include "filesystem.h"
+#include "features.h"
 
 #include <libconfig.h++>
 #include <iostream>
@@ -43,9 +44,24 @@ void Parameters::ReadFromFile(const std::string& filename)
 			filesystem::trim_dir_name(inputDirectory);
 
 			gGlobal.lookupValue("checkSubdirectories", checkSubdirectories);
+			gGlobal.lookupValue("scanThreads", scanThreads);
 			gGlobal.lookupValue("extensionPattern", extensionPattern);
 
 			gGlobal.lookupValue("saveFiles", saveFiles);
+			gGlobal.lookupValue("preserveExif", preserveExif);
+			gGlobal.lookupValue("reducedResolutionDecode", reducedResolutionDecode);
+			gGlobal.lookupValue("matPoolMaxCachedMB", matPoolMaxCachedMB);
+			gGlobal.lookupValue("matPoolHugePages", matPoolHugePages);
+			gGlobal.lookupValue("workersCount", workersCount);
+
+			gGlobal.lookupValue("pipeline", pipeline);
+			gGlobal.lookupValue("pipelineDecodeWorkers", pipelineDecodeWorkers);
+			gGlobal.lookupValue("pipelineDetectWorkers", pipelineDetectWorkers);
+			gGlobal.lookupValue("pipelineGeometryWorkers", pipelineGeometryWorkers);
+			gGlobal.lookupValue("pipelineEncodeWorkers", pipelineEncodeWorkers);
+			gGlobal.lookupValue("pipelineQueueSize", pipelineQueueSize);
+			if (pipelineQueueSize < 1)
+				pipelineQueueSize = 1;
 
 			gGlobal.lookupValue("GUI", GUI);
 
@@ -83,11 +99,24 @@ void Parameters::ReadFromFile(const std::string& filename)
 			gGlobal.lookupValue("logFilename", logFilename);
 			gGlobal.lookupValue("needEyeHorizontalCorrection", needEyeHorizontalCorrection);
 			gGlobal.lookupValue("needCrop", needCrop);
+			gGlobal.lookupValue("losslessJpeg", losslessJpeg);
+			gGlobal.lookupValue("losslessMaxAngle", losslessMaxAngle);
 			gGlobal.lookupValue("cascadeFrontalFaceTemplate", cascadeFrontalFaceTemplate);
 			gGlobal.lookupValue("cascadeEyeTemplate", cascadeEyeTemplate);
 			//gGlobal.lookupValue("configFilename", configFilename);
 
+			gGlobal.lookupValue("statisticsSamples", statisticsSamples);
+			gGlobal.lookupValue("statisticsSpillFile", statisticsSpillFile);
+			gGlobal.lookupValue("statisticsJsonFile", statisticsJsonFile);
+			gGlobal.lookupValue("traceFile", traceFile);
+
 			gGlobal.lookupValue("copyOriginalImageToResultWhenFailed", copyOriginalImageToResultWhenFailed);
+
+			val.clear();
+			gGlobal.lookupValue("copyMode", val);
+			if (val.empty() == false)
+				copyMode = filesystem::CopyModeFromString(val);
+
 			gGlobal.lookupValue("needToCopyResultImageWhenFailed", needToCopyResultImageWhenFailed);
 			gGlobal.lookupValue("alsoCopyOriginalImageToFailedFolder", alsoCopyOriginalImageToFailedFolder);
 			gGlobal.lookupValue("copyResultImageWhenFailedFolder", copyResultImageWhenFailedFolder);
@@ -152,6 +181,8 @@ void Parameters::ReadFromFile(const std::string& filename)
 		std::cout << "WARNING: catch error when reading and apply settings from file " << configFilename << std::endl;
 		ResetToDefaults();
 	}
+
+	applyFeatures();
 }
 
 void Parameters::ResetToDefaults()
@@ -162,14 +193,30 @@ void Parameters::ResetToDefaults()
 	logFilename = "./data/process.log";
 	needEyeHorizontalCorrection = true;
 	needCrop = true;
+	losslessJpeg = false;
+	losslessMaxAngle = 1.0f;
 	cascadeFrontalFaceTemplate = "./data/haarcascade_frontalface_default.xml";
 	cascadeEyeTemplate = "./data/haarcascade_eye.xml";
 
 	configFilename = "settings.cfg";
 
 	saveFiles = true;
+	preserveExif = true;
+	reducedResolutionDecode = true;
+
+	matPoolMaxCachedMB = 512;
+	matPoolHugePages = false;
+
+	workersCount = 1;
 
-	GUI = true;
+	pipeline = false;
+	pipelineDecodeWorkers = 2;
+	pipelineDetectWorkers = 2;
+	pipelineGeometryWorkers = 1;
+	pipelineEncodeWorkers = 2;
+	pipelineQueueSize = 4;
+
+	GUI = PC_FEATURE_DISPLAY != 0;
 
 	drawLineBetweenEyes = true;
 	drawExtrapolationLineBetweenEyes = true;
@@ -191,10 +238,17 @@ void Parameters::ResetToDefaults()
 
 	extensionPattern = "jpg";
 	checkSubdirectories = false;
+	scanThreads = 4;
+
+	statisticsSamples = 1000;
+	statisticsSpillFile = "";
+	statisticsJsonFile = "";
+	traceFile = "";
 
 	copyOriginalImageToResultWhenFailed = true;
+	copyMode = filesystem::CopyContent;
 
-	needToCopyResultImageWhenFailed = true;
+	needToCopyResultImageWhenFailed = PC_FEATURE_DISPLAY != 0;
 	alsoCopyOriginalImageToFailedFolder = true;
 	copyResultImageWhenFailedFolder = "./result/fails";
 
@@ -223,7 +277,20 @@ void Parameters::ResetToDefaults()
 
 bool Parameters::NeedToHaveDisplayedImage()
 {
-	return GUI || needToCopyResultImageWhenFailed;
+	return PC_FEATURE_DISPLAY && (GUI || needToCopyResultImageWhenFailed);
+}
+
+void Parameters::applyFeatures()
+{
+	// NOTE settings of features which are removed from build are turned off
+#if PC_FEATURE_DISPLAY == 0
+	if (GUI || needToCopyResultImageWhenFailed)
+	{
+		std::cout << "WARNING: build has no display support, GUI and needToCopyResultImageWhenFailed are ignored" << std::endl;
+		GUI = false;
+		needToCopyResultImageWhenFailed = false;
+	}
+#endif
 }
 
 }
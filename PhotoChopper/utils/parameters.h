@@ -4,6 +4,7 @@
 #include <vector>
 
 #include "iLog.h"
+#include "fileCopy.h"
 
 namespace pc
 {
@@ -17,8 +18,26 @@ struct Parameters
 	std::string inputDirectory;
 	std::string extensionPattern;
 	bool checkSubdirectories;
+	int  scanThreads; // count of threads which scan subdirectories
 
 	bool saveFiles;
+	bool preserveExif; // copy exif metadata of original image to result
+
+	bool reducedResolutionDecode; // decode jpeg for detection with reduced resolution, full image is decoded only for saving
+
+	// released image buffers are kept and reused by next images (see MatPool)
+	int  matPoolMaxCachedMB; // 0 - turned off
+	bool matPoolHugePages;	 // big buffers are allocated in large pages, requires SeLockMemoryPrivilege
+
+	int workersCount; // count of parallel workers in batch mode, 0 - use all hardware threads
+
+	// staged pipeline mode: decode -> detect -> geometry -> encode
+	bool pipeline;
+	int  pipelineDecodeWorkers;
+	int  pipelineDetectWorkers;
+	int  pipelineGeometryWorkers;
+	int  pipelineEncodeWorkers;
+	int  pipelineQueueSize; // capacity of queue between two stages, at least 1
 
 	bool log;
 	pc::LogType logType;
@@ -45,7 +64,19 @@ struct Parameters
 	bool needEyeHorizontalCorrection;
 	bool needCrop;
 
+	// orientation and crop of jpeg are made losslessly (in DCT domain, without re-encoding)
+	// when angle of eyes line is not greater than losslessMaxAngle degrees.
+	// NOTE result differs from usual one (small tilt isn't corrected, crop is aligned to MCU), so it's off by default
+	bool  losslessJpeg;
+	float losslessMaxAngle;
+
+	int  statisticsSamples;			 // count of kept details for warnings and for every type of fails in each of 16 shards of statistics (threads share shards by hash)
+	std::string statisticsSpillFile; // all warnings and fails are written there, empty - turned off
+	std::string statisticsJsonFile;	 // totals, throughput and stage latencies are exported there, empty - turned off
+	std::string traceFile;			 // timeline of processing in Chrome trace format, empty - turned off
+
 	bool copyOriginalImageToResultWhenFailed;
+	filesystem::CopyMode copyMode; // how original images are copied when processing is failed
 
 	bool needToCopyResultImageWhenFailed;
 	bool alsoCopyOriginalImageToFailedFolder;
@@ -85,6 +116,9 @@ struct Parameters
 	void ResetToDefaults();
 	void ReadFromFile(const std::string& filename);
 	bool NeedToHaveDisplayedImage();
+
+private:
+	void applyFeatures();
 };
 
 }
@@ -0,0 +1,109 @@
+#include "planeCache.h"
+#include "matPool.h"
+
+#include <algorithm>
+
+#include <opencv2/imgproc.hpp>
+
+namespace pc
+{
+namespace utils
+{
+
+PlaneCache::PlaneCache(MatPool& pool)
+	: m_pool(pool)
+	, m_silhouetteThreshold(0)
+	, m_silhouetteRows(0)
+{ }
+
+void PlaneCache::Reset(const cv::Mat& bgr /*= cv::Mat()*/)
+{
+	m_bgr = bgr;
+
+	m_gray = cv::Mat();
+	m_hsv = cv::Mat();
+	m_silhouette.Reset();
+}
+
+void PlaneCache::Crop(const cv::Rect& rect)
+{
+	m_bgr = m_bgr(rect);
+
+	if (m_gray.empty() == false)
+		m_gray = m_gray(rect);
+
+	if (m_hsv.empty() == false)
+		m_hsv = m_hsv(rect);
+
+	m_silhouette.Reset();
+}
+
+const cv::Mat& PlaneCache::Image() const
+{
+	return m_bgr;
+}
+
+const cv::Mat& PlaneCache::Gray()
+{
+	if (m_gray.empty() && m_bgr.empty() == false)
+	{
+		m_gray = pooled();
+
+		// NOTE conversion is the same as it always was in processing, so detection results aren't changed
+		cv::cvtColor(m_bgr, m_gray, cv::COLOR_RGB2GRAY);
+	}
+
+	return m_gray;
+}
+
+const cv::Mat& PlaneCache::Hsv()
+{
+	if (m_hsv.empty() && m_bgr.empty() == false)
+	{
+		m_hsv = pooled();
+		cv::cvtColor(m_bgr, m_hsv, cv::COLOR_BGR2HSV);
+	}
+
+	return m_hsv;
+}
+
+cv::Mat PlaneCache::Hsv(const cv::Rect& rect)
+{
+	if (m_hsv.empty() == false)
+		return m_hsv(rect);
+
+	cv::Mat hsv = pooled();
+	cv::cvtColor(m_bgr(rect), hsv, cv::COLOR_BGR2HSV);
+
+	return hsv;
+}
+
+const ProjectionProfile& PlaneCache::Silhouette(int threshold, int rows)
+{
+	if (Gray().empty())
+		return m_silhouette;
+
+	rows = std::max(0, std::min(rows, m_gray.rows));
+
+	if (m_silhouette.IsEmpty() || m_silhouetteThreshold != threshold || m_silhouetteRows < rows)
+	{
+		cv::Mat mask = pooled();
+		cv::threshold(m_gray.rowRange(0, rows), mask, threshold, 255, cv::THRESH_BINARY_INV);
+
+		m_silhouette.Compute(mask);
+		m_silhouetteThreshold = threshold;
+		m_silhouetteRows = rows;
+	}
+
+	return m_silhouette;
+}
+
+cv::Mat PlaneCache::pooled()
+{
+	cv::Mat mat;
+	m_pool.Attach(mat);
+	return mat;
+}
+
+}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+
+#include "classutils.h"
+#include "projectionProfile.h"
+
+namespace pc
+{
+namespace utils
+{
+
+class MatPool;
+
+// color planes of one BGR image (grayscale, HSV, silhouette profile) which are computed on first request
+// and then shared by all analysis stages, so every conversion is done at most once per image.
+// Planes are dropped when geometry of image is changed (Reset), crop keeps per pixel planes as regions
+class PlaneCache : public noncopyable
+{
+public:
+	explicit PlaneCache(MatPool& pool);
+
+	// image is kept by reference, so it mustn't be changed in place while cache is used
+	void Reset(const cv::Mat& bgr = cv::Mat());
+
+	// region of image and of computed planes, silhouette is computed again if it is needed
+	void Crop(const cv::Rect& rect);
+
+	const cv::Mat& Image() const;
+
+	const cv::Mat& Gray();
+	const cv::Mat& Hsv();
+
+	// region of HSV plane; if whole plane isn't computed yet, only region is converted (and isn't cached)
+	cv::Mat Hsv(const cv::Rect& rect);
+
+	// profile of pixels which aren't brighter than threshold (dark silhouette on light background)
+	// in top rows of image; only these rows are thresholded
+	const ProjectionProfile& Silhouette(int threshold, int rows);
+
+private:
+	// new mat with storage from pool
+	cv::Mat pooled();
+
+private:
+	MatPool& m_pool;
+
+	cv::Mat m_bgr;
+	cv::Mat m_gray;
+	cv::Mat m_hsv;
+
+	ProjectionProfile m_silhouette;
+	int m_silhouetteThreshold;
+	int m_silhouetteRows;
+};
+
+}
+}
@@ -0,0 +1,147 @@
+#include "projectionProfile.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace // anonymous
+{
+	typedef unsigned long long TWord;
+
+	// NOTE empty rows are the most common, so they are skipped by words of 8 pixels
+
+	int firstNonZero(const uchar* data, int count)
+	{
+		int i = 0;
+		for (; i + int(sizeof(TWord)) <= count; i += int(sizeof(TWord)))
+		{
+			TWord word;
+			std::memcpy(&word, data + i, sizeof(TWord));
+			if (word != 0u)
+				break;
+		}
+
+		for (; i < count; ++i)
+		{
+			if (data[i] != 0)
+				return i;
+		}
+
+		return -1;
+	}
+
+	int lastNonZero(const uchar* data, int count)
+	{
+		int i = count;
+		for (; i >= int(sizeof(TWord)); i -= int(sizeof(TWord)))
+		{
+			TWord word;
+			std::memcpy(&word, data + i - sizeof(TWord), sizeof(TWord));
+			if (word != 0u)
+				break;
+		}
+
+		for (; i > 0; --i)
+		{
+			if (data[i - 1] != 0)
+				return i - 1;
+		}
+
+		return -1;
+	}
+} // namespace anonymous
+
+namespace pc
+{
+namespace utils
+{
+
+ProjectionProfile::ProjectionProfile()
+	: m_cols(0)
+{ }
+
+void ProjectionProfile::Compute(const cv::Mat& mask)
+{
+	CV_Assert(mask.type() == CV_8UC1);
+
+	m_cols = mask.cols;
+
+	// NOTE capacity is kept, so next images don't allocate profiles
+	m_first.resize(mask.rows);
+	m_last.resize(mask.rows);
+
+	for (int i = 0; i < mask.rows; ++i)
+	{
+		const uchar* row = mask.ptr<uchar>(i);
+
+		int first = firstNonZero(row, mask.cols);
+		m_first[i] = first;
+		m_last[i] = first < 0 ? -1 : lastNonZero(row, mask.cols);
+	}
+}
+
+void ProjectionProfile::Reset()
+{
+	m_cols = 0;
+	m_first.clear();
+	m_last.clear();
+}
+
+bool ProjectionProfile::IsEmpty() const
+{
+	return m_first.empty();
+}
+
+int ProjectionProfile::Cols() const
+{
+	return m_cols;
+}
+
+bool ProjectionProfile::GetExtents(int rows, int& minx, int& maxx, int& miny) const
+{
+	assert(rows <= int(m_first.size()));
+
+	bool found = false;
+
+	for (int i = 0; i < rows; ++i)
+	{
+		if (m_first[i] < 0)
+			continue;
+
+		if (found == false)
+		{
+			minx = m_first[i];
+			maxx = m_last[i];
+			miny = i;
+			found = true;
+		}
+
+		minx = std::min(minx, m_first[i]);
+		maxx = std::max(maxx, m_last[i]);
+	}
+
+	return found;
+}
+
+int ProjectionProfile::FirstNonZero(const uchar* data, int count)
+{
+	return firstNonZero(data, count);
+}
+
+int ProjectionProfile::FindInColumn(const cv::Mat& image, int col, int from, double value)
+{
+	CV_Assert(image.type() == CV_8UC1 && col >= 0 && col < image.cols);
+
+	const uchar* pixel = image.ptr<uchar>(0) + col;
+
+	for (int i = std::max(0, from); i < image.rows; ++i)
+	{
+		if (pixel[i * image.step] <= value)
+			return i;
+	}
+
+	return -1;
+}
+
+}
+}
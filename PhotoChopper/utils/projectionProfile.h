@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+namespace pc
+{
+namespace utils
+{
+
+// projections of binary mask to rows: first and last foreground (non-zero) column of every row.
+// Profile is computed by one pass over mask, then silhouette borders are found from it
+// without touching pixels again
+class ProjectionProfile
+{
+public:
+	ProjectionProfile();
+
+	void Compute(const cv::Mat& mask);
+	void Reset();
+
+	bool IsEmpty() const;
+	int  Cols() const;
+
+	// bounding box of foreground in rows [0, rows), false if there is no one
+	bool GetExtents(int rows, int& minx, int& maxx, int& miny) const;
+
+	// index of first non-zero byte, -1 if there is no one
+	static int FirstNonZero(const uchar* data, int count);
+
+	// first row from 'from' where pixel of one channel image column isn't greater than value, -1 if there is no one
+	static int FindInColumn(const cv::Mat& image, int col, int from, double value);
+
+private:
+	int m_cols;
+	std::vector<int> m_first; // -1 if row has no foreground
+	std::vector<int> m_last;
+};
+
+}
+}
@@ -1,15 +1,48 @@
 #include "statistics.h"
+#include "trace.h"
+
+#include <functional>
+#include <thread>
+
+namespace // anonymous
+{
+	const int g_warningsCategory = 0;
+
+	const char* categoryName(int category)
+	{
+		static const char* names[] = { "warning", "fail:open", "fail:save", "fail:detection", "fail:other" };
+		return names[category];
+	}
+
+} // namespace anonymous
 
 namespace pc
 {
 namespace utils
 {
-	
+
+AllocationCounters::AllocationCounters()
+	: allocations(0u), hits(0u)
+	, systemAllocations(0u), hugePageAllocations(0u)
+	, systemBytes(0u), cachedBytes(0u), peakCachedBytes(0u)
+{ }
+
 Statistics::Statistics()
+	: m_samplesCapacity(1000u)
+	, m_trace(nullptr)
 {
+	for (int i = 0; i < ShardsCount; ++i)
+		m_shards[i].reset(new Shard());
+
+	for (int i = 0; i < StagesCount; ++i)
+		m_stageTimes[i].reset(new LatencyHistogram());
+
 	Reset();
 }
 
+Statistics::~Statistics()
+{ }
+
 Statistics::Info::Info(const std::string& file, const std::string& msg)
 	: filename(file), message(msg)
 {}
@@ -19,23 +52,139 @@ Statistics::Info::Info()
 
 void Statistics::Reset()
 {
-	m_success.clear();
-	m_warning.clear();
-	m_fail.clear();
+	m_successCount = 0;
+	m_warningsCount = 0;
+	m_totalFailCount = 0;
+
+	for (int i = 0; i < FailTypesCount; ++i)
+		m_failCount[i] = 0;
+
+	for (int i = 0; i < StagesCount; ++i)
+		m_stageTimes[i]->Reset();
+
+	m_bytesRead = 0u;
+	m_bytesWritten = 0u;
+
+	m_timer.Reset();
+	m_timingStopped = false;
+	m_totalTime = 0.f;
+
+	m_allocations = AllocationCounters();
+
+	for (int i = 0; i < ShardsCount; ++i)
+	{
+		Shard& shard = *m_shards[i];
+		std::lock_guard<std::mutex> lock(shard.mutex);
+
+		for (int j = 0; j < CategoriesCount; ++j)
+		{
+			shard.categories[j].samples.clear();
+			shard.categories[j].seen = 0u;
+		}
+
+		shard.random.seed(unsigned(i + 1));
+		shard.lastFilename.reset();
+	}
+}
+
+void Statistics::SetSampling(size_t samplesCapacity, const std::string& spillFilename)
+{
+	m_samplesCapacity = samplesCapacity;
+
+	std::lock_guard<std::mutex> lock(m_spillMutex);
+	m_spill.reset();
+
+	if (spillFilename.empty() == false)
+	{
+		m_spill.reset(new std::ofstream(spillFilename, std::ios::out | std::ios::app));
+		if (!*m_spill)
+			m_spill.reset();
+	}
 }
 
 void Statistics::AddSuccess(const Info& file)
 {
-	m_success.push_back(file);
+	++m_successCount;
 }
 
 void Statistics::AddWarning(const Info& file)
 {
-	m_warning.push_back(file);
+	++m_warningsCount;
+	addRecord(g_warningsCategory, file);
 }
+
 void Statistics::AddFail(const Info& file, FailType type)
 {
-	m_fail[type].push_back(file);
+	++m_failCount[int(type)];
+	++m_totalFailCount;
+	addRecord(int(type) + 1, file);
+}
+
+Statistics::Shard& Statistics::currentShard()
+{
+	size_t hash = std::hash<std::thread::id>()(std::this_thread::get_id());
+	return *m_shards[hash % ShardsCount];
+}
+
+void Statistics::addRecord(int category, const Info& file)
+{
+	spill(category, file);
+
+	Shard& shard = currentShard();
+	std::lock_guard<std::mutex> lock(shard.mutex);
+
+	if (shard.lastFilename == nullptr || *shard.lastFilename != file.filename)
+		shard.lastFilename = std::make_shared<const std::string>(file.filename);
+
+	Record record;
+	record.filename = shard.lastFilename;
+	record.message = file.message;
+
+	addSample(shard, category, record);
+}
+
+void Statistics::addSample(Shard& shard, int category, const Record& record)
+{
+	Reservoir& reservoir = shard.categories[category];
+	unsigned long long seen = reservoir.seen++;
+
+	if (reservoir.samples.size() < m_samplesCapacity)
+	{
+		reservoir.samples.push_back(record);
+	}
+	else if (m_samplesCapacity > 0u)
+	{
+		// every record is kept with equal probability
+		unsigned long long index = (unsigned long long)shard.random() % (seen + 1u);
+		if (index < m_samplesCapacity)
+			reservoir.samples[size_t(index)] = record;
+	}
+}
+
+void Statistics::spill(int category, const Info& file)
+{
+	std::lock_guard<std::mutex> lock(m_spillMutex);
+
+	if (m_spill == nullptr)
+		return;
+
+	*m_spill << categoryName(category) << '\t' << file.filename << '\t' << file.message << '\n';
+}
+
+Statistics::TInfoVec Statistics::collect(int category) const
+{
+	TInfoVec infos;
+
+	for (int i = 0; i < ShardsCount; ++i)
+	{
+		Shard& shard = *m_shards[i];
+		std::lock_guard<std::mutex> lock(shard.mutex);
+
+		for (const Record& record : shard.categories[category].samples)
+			infos.push_back(Info(*record.filename, record.message));
+	}
+
+	return infos;
 }
 
 int Statistics::GetTotalProcessedCount()
@@ -45,55 +194,187 @@ int Statistics::GetTotalProcessedCount()
 
 int Statistics::GetSuccessCount()
 {
-	return m_success.size();
+	return m_successCount;
 }
 
 int Statistics::GetWarningsCount()
 {
-	return m_warning.size();
+	return m_warningsCount;
 }
 
 int Statistics::GetTotalFailCount()
 {
-	int count = 0;
+	return m_totalFailCount;
+}
 
-	for each(const auto& t in m_fail)
+int Statistics::GetFailCount(FailType failType)
+{
+	return m_failCount[int(failType)];
+}
+
+Statistics::TInfoVec Statistics::GetFails(FailType failType)
+{
+	return collect(int(failType) + 1);
+}
+
+Statistics::TFailedInfos Statistics::GetFails()
+{
+	TFailedInfos fails;
+
+	const FailType types[FailTypesCount] = { FailType::OpenFile, FailType::SaveFile, FailType::FaceDetection, FailType::Other };
+	for (FailType type : types)
 	{
-		count += t.second.size();
+		if (GetFailCount(type) > 0)
+			fails[type] = GetFails(type);
 	}
 
-	return count;
+	return fails;
 }
 
-int Statistics::GetFailCount(FailType failType)
+Statistics::TInfoVec Statistics::GetWarnings()
+{
+	return collect(g_warningsCategory);
+}
+
+const char* Statistics::GetStageName(Stage stage)
 {
-	TFailedInfos::const_iterator it = m_fail.find(failType);
+	static const char* names[StagesCount] = {
+		"readFile", "decode", "prepare", "readExif", "grayscale", "faceDetection", "eyesDetection",
+		"lips", "faceBottom", "chin", "rotation", "contours", "losslessTransform", "transform",
+		"encode", "writeExif", "writeFile", "copyFailed", "image"
+	};
+
+	return names[int(stage)];
+}
 
-	if (it != m_fail.end())
-		return it->second.size();
-	else
-		return 0;
+void Statistics::SetAllocationCounters(const AllocationCounters& counters)
+{
+	m_allocations = counters;
+}
+
+const AllocationCounters& Statistics::GetAllocationCounters() const
+{
+	return m_allocations;
+}
+
+void Statistics::SetTrace(TraceRecorder* trace)
+{
+	m_trace = trace;
+}
+
+TraceRecorder* Statistics::GetTrace()
+{
+	return m_trace;
+}
+
+void Statistics::AddTime(Stage stage, double ms)
+{
+	m_stageTimes[int(stage)]->Record(ms);
+}
+
+void Statistics::AddBytesRead(unsigned long long bytes)
+{
+	m_bytesRead += bytes;
 }
 
-const Statistics::TInfoVec& Statistics::GetFails(FailType failType)
+void Statistics::AddBytesWritten(unsigned long long bytes)
 {
-	TFailedInfos::const_iterator it = m_fail.find(failType);
-	if (it != m_fail.end())
-		return it->second;
-	else
-		throw std::invalid_argument("elements for specified failType not found");
+	m_bytesWritten += bytes;
 }
 
-const Statistics::TFailedInfos& Statistics::GetFails()
+const LatencyHistogram& Statistics::GetStageTimes(Stage stage) const
 {
-	return m_fail;
+	return *m_stageTimes[int(stage)];
+}
+
+unsigned long long Statistics::GetBytesRead()
+{
+	return m_bytesRead;
+}
+
+unsigned long long Statistics::GetBytesWritten()
+{
+	return m_bytesWritten;
+}
+
+void Statistics::StopTiming()
+{
+	m_totalTime = float(m_timer.ElapsedMs());
+	m_timingStopped = true;
 }
 
 float Statistics::GetTotalTime()
 {
-	// not implemented yet
-	return -1.f;
+	return m_timingStopped ? m_totalTime : float(m_timer.ElapsedMs());
+}
+
+bool Statistics::WriteJson(const std::string& filename)
+{
+	std::ofstream file(filename, std::ios::out | std::ios::trunc);
+	if (!file)
+		return false;
+
+	double seconds = GetTotalTime() / 1000.0;
+	double megabytes = double(GetBytesRead()) / (1024.0 * 1024.0);
+
+	file << "{\n";
+	file << "  \"processed\": " << GetTotalProcessedCount() << ",\n";
+	file << "  \"success\": " << GetSuccessCount() << ",\n";
+	file << "  \"warnings\": " << GetWarningsCount() << ",\n";
+	file << "  \"fails\": " << GetTotalFailCount() << ",\n";
+	file << "  \"totalTimeMs\": " << GetTotalTime() << ",\n";
+	file << "  \"bytesRead\": " << GetBytesRead() << ",\n";
+	file << "  \"bytesWritten\": " << GetBytesWritten() << ",\n";
+	file << "  \"imagesPerSecond\": " << (seconds > 0.0 ? GetTotalProcessedCount() / seconds : 0.0) << ",\n";
+	file << "  \"megabytesPerSecond\": " << (seconds > 0.0 ? megabytes / seconds : 0.0) << ",\n";
+
+	file << "  \"allocations\": { \"count\": " << m_allocations.allocations
+		<< ", \"poolHits\": " << m_allocations.hits
+		<< ", \"systemAllocations\": " << m_allocations.systemAllocations
+		<< ", \"hugePageAllocations\": " << m_allocations.hugePageAllocations
+		<< ", \"systemBytes\": " << m_allocations.systemBytes
+		<< ", \"peakCachedBytes\": " << m_allocations.peakCachedBytes << " },\n";
+
+	file << "  \"stages\": {";
+
+	bool first = true;
+	for (int i = 0; i < StagesCount; ++i)
+	{
+		const LatencyHistogram& times = *m_stageTimes[i];
+		if (times.GetCount() == 0u)
+			continue;
+
+		file << (first ? "\n    " : ",\n    ") << ToJsonString(GetStageName(Stage(i)));
+
+		file << ": { \"count\": " << times.GetCount()
+			<< ", \"totalMs\": " << times.GetTotal()
+			<< ", \"meanMs\": " << times.GetMean()
+			<< ", \"p50Ms\": " << times.GetPercentile(50.0)
+			<< ", \"p95Ms\": " << times.GetPercentile(95.0)
+			<< ", \"p99Ms\": " << times.GetPercentile(99.0)
+			<< ", \"maxMs\": " << times.GetMax() << " }";
+
+		first = false;
+	}
+
+	file << "\n  }\n}\n";
+
+	return bool(file);
+}
+
+StageTimer::StageTimer(Statistics& stats, Statistics::Stage stage)
+	: m_stats(stats), m_stage(stage)
+	, m_trace(stats.GetTrace())
+	, m_traceStart(m_trace != nullptr ? m_trace->Now() : 0)
+{ }
+
+StageTimer::~StageTimer()
+{
+	m_stats.AddTime(m_stage, m_timer.ElapsedMs());
+
+	if (m_trace != nullptr)
+		m_trace->AddEvent(Statistics::GetStageName(m_stage), "stage", m_traceStart, m_trace->Now());
 }
 
 }
-}
\ No newline at end of file
+}
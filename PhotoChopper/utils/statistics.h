@@ -1,8 +1,17 @@
 #pragma once
 
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
 #include <string>
 #include <vector>
-#include <map>
+
+#include "classutils.h"
+#include "latencyHistogram.h"
+#include "utils.h"
 
 namespace pc
 {
@@ -10,7 +19,27 @@ namespace pc
 namespace utils
 {
 
-class Statistics
+class TraceRecorder;
+
+// counters of pooled image buffers (see MatPool)
+struct AllocationCounters
+{
+	unsigned long long allocations;			// of big buffers
+	unsigned long long hits;				// buffers reused from pool
+	unsigned long long systemAllocations;	// new buffers from system
+	unsigned long long hugePageAllocations;
+	unsigned long long systemBytes;
+	unsigned long long cachedBytes;			// in released buffers at the moment
+	unsigned long long peakCachedBytes;
+
+	AllocationCounters();
+};
+
+// thread-safe statistics of processing.
+// Totals are atomic counters; details (filename and message) of warnings and fails are kept only
+// as bounded random samples in per-thread shards, which are merged on read.
+// All records can be also written to spill file
+class Statistics : public noncopyable
 {
 public:
 
@@ -31,12 +60,47 @@ public:
 		Other
 	};
 
+	// stages of processing which are timed separately
+	enum class Stage
+	{
+		ReadFile,
+		Decode,
+		Prepare,			// border, orientation and resize
+		ReadExif,
+		Grayscale,
+		FaceDetection,
+		EyesDetection,
+		Lips,
+		FaceBottom,			// includes chin
+		Chin,
+		Rotation,			// of resized image
+		Contours,
+		LosslessTransform,
+		Transform,			// rotation and crop of full size image
+		Encode,
+		WriteExif,
+		WriteFile,
+		CopyFailed,
+		Image				// whole processing of one image
+	};
+
+	static const int StagesCount = int(Stage::Image) + 1;
+	static const char* GetStageName(Stage stage);
+
 	typedef std::vector<Info> TInfoVec;
 	typedef std::map<FailType, TInfoVec> TFailedInfos;
 
 	Statistics();
+	~Statistics();
+
+	// NOTE mustn't be called while records are added from other threads
 	void Reset();
 
+	// samplesCapacity - max count of kept details for warnings and for every fail type in every shard
+	// (so up to ShardsCount times more in total);
+	// spillFilename - file for all warnings and fails, empty to turn off
+	void SetSampling(size_t samplesCapacity, const std::string& spillFilename = std::string());
+
 	void AddSuccess(const Info& file);
 	void AddWarning(const Info& file);
 	void AddFail(const Info& file, FailType type);
@@ -46,15 +110,114 @@ public:
 	int  GetWarningsCount();
 	int  GetTotalFailCount();
 	int  GetFailCount(FailType failType);
-	const TFailedInfos& GetFails();
-	const TInfoVec& GetFails(FailType failType);
 
+	// samples of details, merged from all shards
+	TFailedInfos GetFails();
+	TInfoVec GetFails(FailType failType);
+	TInfoVec GetWarnings();
+
+	void AddTime(Stage stage, double ms);
+	void AddBytesRead(unsigned long long bytes);
+	void AddBytesWritten(unsigned long long bytes);
+
+	const LatencyHistogram& GetStageTimes(Stage stage) const;
+	unsigned long long GetBytesRead();
+	unsigned long long GetBytesWritten();
+
+	// wall time is measured from Reset to StopTiming
+	void  StopTiming();
+
+	// in milliseconds
 	float GetTotalTime();
-protected:
-	TFailedInfos	m_fail;
-	TInfoVec		m_warning;
-	TInfoVec		m_success;
+
+	// totals, throughput and latencies of stages
+	bool WriteJson(const std::string& filename);
+
+	// NOTE pool is shared by whole process, so counters are set as snapshot (they aren't merged)
+	void SetAllocationCounters(const AllocationCounters& counters);
+	const AllocationCounters& GetAllocationCounters() const;
+
+	// stages are also recorded to trace while it's set; nullptr to turn off
+	void SetTrace(TraceRecorder* trace);
+	TraceRecorder* GetTrace();
+
+private:
+	static const int FailTypesCount = 4;
+	static const int ShardsCount = 16;
+
+	// index 0 - warnings, then fail types
+	static const int CategoriesCount = FailTypesCount + 1;
+
+	struct Record
+	{
+		std::shared_ptr<const std::string> filename;
+		std::string message;
+	};
+
+	// uniform random sample of records (reservoir sampling)
+	struct Reservoir
+	{
+		std::vector<Record> samples;
+		unsigned long long	seen;
+	};
+
+	struct Shard
+	{
+		std::mutex   mutex;
+		Reservoir    categories[CategoriesCount];
+		std::minstd_rand random;
+
+		// filename interning: records of the file which is processed by this thread share one string
+		std::shared_ptr<const std::string> lastFilename;
+	};
+
+	Shard& currentShard();
+	void   addRecord(int category, const Info& file);
+	void   addSample(Shard& shard, int category, const Record& record);
+	void   spill(int category, const Info& file);
+
+	TInfoVec collect(int category) const;
+
+private:
+	std::atomic<int> m_successCount;
+	std::atomic<int> m_warningsCount;
+	std::atomic<int> m_totalFailCount;
+	std::atomic<int> m_failCount[FailTypesCount];
+
+	size_t m_samplesCapacity;
+	std::unique_ptr<Shard> m_shards[ShardsCount];
+
+	std::unique_ptr<std::ofstream> m_spill;
+	std::mutex m_spillMutex;
+
+	std::unique_ptr<LatencyHistogram> m_stageTimes[StagesCount];
+	std::atomic<unsigned long long> m_bytesRead;
+	std::atomic<unsigned long long> m_bytesWritten;
+
+	Timer m_timer;
+	std::atomic<bool> m_timingStopped;
+	float m_totalTime;
+
+	AllocationCounters m_allocations;
+
+	TraceRecorder* m_trace;
+};
+
+// adds time of scope to statistics (and to trace if it's turned on)
+class StageTimer : public noncopyable
+{
+public:
+	StageTimer(Statistics& stats, Statistics::Stage stage);
+	~StageTimer();
+
+private:
+	Statistics&		  m_stats;
+	Statistics::Stage m_stage;
+	Timer			  m_timer;
+
+	TraceRecorder*	  m_trace;
+	long long		  m_traceStart;
 };
 
 }
-}
\ No newline at end of file
+}
@@ -0,0 +1,149 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <fstream>
+
+#include <windows.h>
+
+namespace pc
+{
+namespace utils
+{
+
+TraceFileInfo::TraceFileInfo()
+	: width(0), height(0)
+	, resultWidth(0), resultHeight(0)
+	, bytesRead(0u), bytesWritten(0u)
+	, success(false)
+{ }
+
+TraceRecorder::TraceRecorder()
+	: m_nextId(1u)
+{
+	for (int i = 0; i < ShardsCount; ++i)
+		m_shards[i].reset(new Shard());
+}
+
+TraceRecorder::~TraceRecorder()
+{ }
+
+long long TraceRecorder::Now() const
+{
+	return (long long)(m_timer.ElapsedMs() * 1000.0);
+}
+
+void TraceRecorder::AddEvent(const char* name, const char* category, long long start, long long end,
+	const std::string& filename /*= std::string()*/)
+{
+	Event event;
+	event.name = name;
+	event.category = category;
+	event.phase = 'X';
+	event.start = start;
+	event.duration = end - start;
+	event.id = 0u;
+
+	if (filename.empty() == false)
+	{
+		TraceFileInfo* info = new TraceFileInfo();
+		info->filename = filename;
+		event.file.reset(info);
+	}
+
+	addEvent(event);
+}
+
+void TraceRecorder::AddFileEvent(long long start, long long end, const TraceFileInfo& info)
+{
+	Event event;
+	event.name = "file";
+	event.category = "file";
+	event.phase = 'A';
+	event.start = start;
+	event.duration = end - start;
+	event.file = std::make_shared<const TraceFileInfo>(info);
+
+	{
+		std::lock_guard<std::mutex> lock(m_idMutex);
+		event.id = m_nextId++;
+	}
+
+	addEvent(event);
+}
+
+void TraceRecorder::addEvent(Event& event)
+{
+	event.threadId = unsigned(GetCurrentThreadId());
+
+	// NOTE ids of windows threads are multiples of 4, low bits would select only every 4th shard
+	Shard& shard = *m_shards[(event.threadId >> 2) % ShardsCount];
+	std::lock_guard<std::mutex> lock(shard.mutex);
+
+	shard.events.push_back(event);
+}
+
+bool TraceRecorder::Write(const std::string& filename)
+{
+	std::vector<Event> events;
+
+	for (int i = 0; i < ShardsCount; ++i)
+	{
+		Shard& shard = *m_shards[i];
+		std::lock_guard<std::mutex> lock(shard.mutex);
+
+		events.insert(events.end(), shard.events.begin(), shard.events.end());
+	}
+
+	std::stable_sort(events.begin(), events.end(), [](const Event& a, const Event& b) { return a.start < b.start; });
+
+	std::ofstream file(filename, std::ios::out | std::ios::trunc);
+	if (!file)
+		return false;
+
+	const unsigned processId = unsigned(GetCurrentProcessId());
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << processId << ",\"args\":{\"name\":\"PhotoChopper\"}}";
+
+	for (const Event& event : events)
+	{
+		std::string args;
+		if (event.file != nullptr)
+		{
+			const TraceFileInfo& info = *event.file;
+
+			args = ",\"args\":{\"file\":" + ToJsonString(info.filename);
+
+			if (event.phase == 'A')
+			{
+				args += ",\"width\":" + std::to_string(info.width) + ",\"height\":" + std::to_string(info.height)
+					+ ",\"resultWidth\":" + std::to_string(info.resultWidth) + ",\"resultHeight\":" + std::to_string(info.resultHeight)
+					+ ",\"bytesRead\":" + std::to_string(info.bytesRead) + ",\"bytesWritten\":" + std::to_string(info.bytesWritten)
+					+ ",\"success\":" + (info.success ? "true" : "false");
+			}
+
+			args += "}";
+		}
+
+		std::string common = "\"name\":\"" + std::string(event.name) + "\",\"cat\":\"" + event.category
+			+ "\",\"pid\":" + std::to_string(processId) + ",\"tid\":" + std::to_string(event.threadId);
+
+		if (event.phase == 'X')
+		{
+			file << ",\n{" << common << ",\"ph\":\"X\",\"ts\":" << event.start << ",\"dur\":" << event.duration << args << "}";
+		}
+		else
+		{
+			// NOTE begin and end of async event are matched by id
+			file << ",\n{" << common << ",\"ph\":\"b\",\"id\":" << event.id << ",\"ts\":" << event.start << args << "}";
+			file << ",\n{" << common << ",\"ph\":\"e\",\"id\":" << event.id << ",\"ts\":" << event.start + event.duration << "}";
+		}
+	}
+
+	file << "\n]}\n";
+
+	return bool(file);
+}
+
+}
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "classutils.h"
+#include "utils.h"
+
+namespace pc
+{
+namespace utils
+{
+
+// details of processed file shown in timeline
+struct TraceFileInfo
+{
+	std::string filename;
+	int width;
+	int height;
+	int resultWidth;
+	int resultHeight;
+	unsigned long long bytesRead;
+	unsigned long long bytesWritten;
+	bool success;
+
+	TraceFileInfo();
+};
+
+// records timeline of processing and writes it in Chrome trace format
+// (can be opened in chrome://tracing or Perfetto UI).
+// NOTE all events are kept in memory until Write, so it's for profiling runs only
+class TraceRecorder : public noncopyable
+{
+public:
+	TraceRecorder();
+	~TraceRecorder();
+
+	// microseconds since creation of recorder
+	long long Now() const;
+
+	// event of calling thread; name and category must be string literals
+	void AddEvent(const char* name, const char* category, long long start, long long end,
+		const std::string& filename = std::string());
+
+	// lifetime of file, which can be processed by several threads (pipeline)
+	void AddFileEvent(long long start, long long end, const TraceFileInfo& info);
+
+	bool Write(const std::string& filename);
+
+private:
+	struct Event
+	{
+		const char* name;
+		const char* category;
+		char		phase;	// 'X' - complete event of thread, 'A' - async begin and end
+		long long	start;
+		long long	duration;
+		unsigned	threadId;
+		unsigned long long id;
+
+		std::shared_ptr<const TraceFileInfo> file;
+	};
+
+	struct Shard
+	{
+		std::mutex mutex;
+		std::vector<Event> events;
+	};
+
+	static const int ShardsCount = 16;
+
+	void addEvent(Event& event);
+
+private:
+	Timer m_timer;
+	std::unique_ptr<Shard> m_shards[ShardsCount];
+
+	std::mutex m_idMutex;
+	unsigned long long m_nextId;
+};
+
+// adds event for scope to trace, does nothing when trace is turned off
+class TraceScope : public noncopyable
+{
+public:
+	// NOTE filename must live until end of scope
+	TraceScope(TraceRecorder* trace, const char* name, const char* category, const std::string* filename = nullptr)
+		: m_trace(trace), m_name(name), m_category(category), m_filename(filename)
+		, m_start(trace != nullptr ? trace->Now() : 0)
+	{ }
+
+	~TraceScope()
+	{
+		if (m_trace != nullptr)
+			m_trace->AddEvent(m_name, m_category, m_start, m_trace->Now(), m_filename != nullptr ? *m_filename : std::string());
+	}
+
+private:
+	TraceRecorder*	   m_trace;
+	const char*		   m_name;
+	const char*		   m_category;
+	const std::string* m_filename;
+	long long		   m_start;
+};
+
+}
+}
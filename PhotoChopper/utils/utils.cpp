@@ -4,10 +4,33 @@
 #include <iomanip>
 #include <sstream>
 
+#include "features.h"
+
+#if PC_FEATURE_DISPLAY
 #include <opencv2/highgui.hpp>
+#endif
+
+#include <windows.h>
 
 namespace // anonymous
 {
+	long long getPerformanceCounter()
+	{
+		LARGE_INTEGER counter;
+		QueryPerformanceCounter(&counter);
+		return counter.QuadPart;
+	}
+
+	double getPerformanceFrequency()
+	{
+		LARGE_INTEGER freq;
+		QueryPerformanceFrequency(&freq);
+		return double(freq.QuadPart);
+	}
+
+	// NOTE initialized before main, so there is no race between threads
+	const double g_performanceFrequency = getPerformanceFrequency();
+
 	std::tm gettm()
 	{
 		std::chrono::time_point<std::chrono::system_clock> now =
@@ -49,12 +72,18 @@ std::string GetDate()
 
 int WaitForKeyOpenCV()
 {
+#if PC_FEATURE_DISPLAY
 	return cv::waitKey(0);
+#else
+	return 0;
+#endif
 }
 
 void CloseAllOpenCVWindows()
 {
+#if PC_FEATURE_DISPLAY
 	cv::destroyAllWindows();
+#endif
 }
 
 float lerp(float a, float b, float param)
@@ -62,5 +91,59 @@ float lerp(float a, float b, float param)
 	return a + (b - a) * param;
 }
 
+std::string ToJsonString(const std::string& str)
+{
+	std::string result = "\"";
+
+	// NOTE strings (file names) are in ANSI code page, json must be unicode,
+	// so non-ascii characters are converted to UTF-16 and escaped
+	std::wstring wide;
+	if (str.empty() == false)
+	{
+		int length = MultiByteToWideChar(CP_ACP, 0, str.c_str(), int(str.size()), nullptr, 0);
+		wide.resize(size_t(length));
+
+		if (length > 0)
+			MultiByteToWideChar(CP_ACP, 0, str.c_str(), int(str.size()), &wide[0], length);
+	}
+
+	for (wchar_t c : wide)
+	{
+		if (c == L'"' || c == L'\\')
+		{
+			result += '\\';
+			result += char(c);
+		}
+		else if (c < 0x20 || c >= 0x80)
+		{
+			char code[8];
+			sprintf_s(code, "\\u%04x", unsigned(c));
+			result += code;
+		}
+		else
+		{
+			result += char(c);
+		}
+	}
+
+	result += '"';
+	return result;
+}
+
+Timer::Timer()
+{
+	Reset();
+}
+
+void Timer::Reset()
+{
+	m_start = getPerformanceCounter();
+}
+
+double Timer::ElapsedMs() const
+{
+	return double(getPerformanceCounter() - m_start) * 1000.0 / g_performanceFrequency;
+}
+
 }
 }
\ No newline at end of file
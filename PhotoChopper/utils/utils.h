@@ -21,5 +21,21 @@ void CloseAllOpenCVWindows();
 
 float lerp(float a, float b, float param);
 
+// quoted and escaped string for JSON output; string is in ANSI code page, non-ascii characters are written as \u escapes
+std::string ToJsonString(const std::string& str);
+
+// high resolution timer (std::chrono clocks in MSVC 2013 have low resolution)
+class Timer
+{
+public:
+	Timer();
+
+	void   Reset();
+	double ElapsedMs() const;
+
+private:
+	long long m_start;
+};
+
 }
 }
\ No newline at end of file